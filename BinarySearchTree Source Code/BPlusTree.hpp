@@ -0,0 +1,1020 @@
+//============================================================================
+// Name        : BPlusTree.hpp
+// Author      : John Austin
+// Version     : 1.0
+// Copyright   : Copyright © 2017 SNHU COCE
+// Description : Cache-friendly B+ tree used as an alternative bid index
+//============================================================================
+
+#ifndef     _BPLUSTREE_HPP_
+# define    _BPLUSTREE_HPP_
+
+# include <utility>
+# include <vector>
+
+/**
+ * Summarize policy of a B+ tree that keeps no summary of its keys
+ *
+ * A policy names a Summary type, empty when default constructed and
+ * combined with +=, which must give the same result in any order, and
+ * gives the summary of one key on its own.
+ */
+struct NoKeySummary {
+    struct Summary {
+        Summary& operator+=(const Summary&) { return *this; }
+    };
+
+    template <typename Key> Summary Element(const Key&) const { return Summary(); }
+};
+
+/**
+ * Ordered set of unique keys stored in wide nodes
+ *
+ * Every node holds up to Order keys side by side, so a search touches
+ * a few cache lines per level instead of one node per comparison, and
+ * the tree is only log(n) / log(Order) levels deep. All keys live in
+ * the leaves, which are chained in both directions so ordered scans
+ * run sequentially along the leaf level without going back up.
+ * Inner nodes also count the keys under each child, so a position in
+ * the order is found, or counted up to, in one descent. With a
+ * Summarize policy other than NoKeySummary they keep a summary of the
+ * keys under each child too, and summarize a key range the same way.
+ *
+ * Less must be a strict weak ordering in which no two stored keys are
+ * equivalent; callers that need duplicates add a tie breaker to the key.
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize = NoKeySummary>
+class BPlusTree {
+
+    static_assert(Order >= 4, "B+ tree nodes need room for at least four keys");
+
+public:
+    typedef typename Summarize::Summary Summary;
+
+private:
+    struct NodeBase {
+        unsigned int count; // keys in use
+        bool leaf;
+    };
+
+    // keys[i] separates children[i] (smaller keys) from children[i + 1]
+    struct Inner : NodeBase {
+        Key keys[Order];
+        NodeBase* children[Order + 1];
+        unsigned int weights[Order + 1]; // keys under each child
+        Summary summaries[Order + 1]; // of the keys under each child
+    };
+
+    struct Leaf : NodeBase {
+        Key keys[Order];
+        Leaf* prev;
+        Leaf* next;
+    };
+
+    static const unsigned int minCount = Order / 2;
+    static const unsigned int maxDepth = 64;
+
+    NodeBase* root;
+    Leaf* head; // leftmost leaf
+    Leaf* tail; // rightmost leaf
+    unsigned int size;
+    Less less;
+    Summarize summarize;
+
+    template <typename K> unsigned int lowerBound(const Key* keys, unsigned int count, const K& key) const;
+    template <typename K> unsigned int upperBound(const Key* keys, unsigned int count, const K& key) const;
+    void rebalance(Inner** path, unsigned int* slots, unsigned int depth, NodeBase* node);
+    static unsigned int weightOf(const NodeBase* node);
+    Summary summaryOf(const NodeBase* node) const;
+    template <typename K> void summarizeFrom(const NodeBase* node, const K& low, Summary& total) const;
+    template <typename K> void summarizeUpTo(const NodeBase* node, const K& high, Summary& total) const;
+
+public:
+    /**
+     * Position of one key in the leaf level, used to walk in order
+     */
+    class Position {
+        friend class BPlusTree;
+
+    private:
+        Leaf* leaf;
+        unsigned int index;
+
+    public:
+        Position(Leaf* aLeaf = nullptr, unsigned int anIndex = 0) {
+            leaf = aLeaf;
+            index = anIndex;
+        }
+        bool IsValid() const {
+            return leaf != nullptr;
+        }
+        const Key& Value() const {
+            return leaf->keys[index];
+        }
+        void Next() {
+            if (++index == leaf->count) {
+                leaf = leaf->next;
+                index = 0;
+            }
+        }
+        void Prev() {
+            if (index == 0) {
+                leaf = leaf->prev;
+                index = (leaf != nullptr) ? leaf->count - 1 : 0;
+            }
+            else {
+                index--;
+            }
+        }
+    };
+
+    BPlusTree();
+    virtual ~BPlusTree();
+    void Clear();
+    unsigned int Size() const;
+    void BulkLoad(const std::vector<Key>& sorted);
+    bool Insert(const Key& key);
+    bool Remove(const Key& key);
+    Position Begin() const;
+    Position Last() const;
+    template <typename K> Position LowerBound(const K& key) const;
+    template <typename K> Position UpperBound(const K& key) const;
+    template <typename K> unsigned int CountBelow(const K& key) const;
+    template <typename K> unsigned int CountUpTo(const K& key) const;
+    Position Select(unsigned int index) const;
+    template <typename K> Summary SummarizeBetween(const K& low, const K& high) const;
+};
+
+/**
+ * Default constructor
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+BPlusTree<Key, Less, Order, Summarize>::BPlusTree() {
+    root = nullptr;
+    head = nullptr;
+    tail = nullptr;
+    size = 0;
+}
+
+/**
+ * Destructor
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+BPlusTree<Key, Less, Order, Summarize>::~BPlusTree() {
+    this->Clear();
+}
+
+/**
+ * Delete every node, walking with an explicit stack instead of recursion
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+void BPlusTree<Key, Less, Order, Summarize>::Clear() {
+    std::vector<NodeBase*> pending;
+    if (root != nullptr) {
+        pending.push_back(root);
+    }
+    while (!pending.empty()) {
+        NodeBase* node = pending.back();
+        pending.pop_back();
+        if (node->leaf) {
+            delete static_cast<Leaf*>(node);
+        }
+        else {
+            Inner* inner = static_cast<Inner*>(node);
+            for (unsigned int i = 0; i <= inner->count; i++) {
+                pending.push_back(inner->children[i]);
+            }
+            delete inner;
+        }
+    }
+    root = nullptr;
+    head = nullptr;
+    tail = nullptr;
+    size = 0;
+}
+
+/**
+ * Number of keys in the tree
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+unsigned int BPlusTree<Key, Less, Order, Summarize>::Size() const {
+    return size;
+}
+
+/**
+ * Index of the first key in a node that is not less than key
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+unsigned int BPlusTree<Key, Less, Order, Summarize>::lowerBound(const Key* keys, unsigned int count, const K& key) const {
+    unsigned int low = 0;
+    while (count > 0) {
+        unsigned int half = count / 2;
+        if (less(keys[low + half], key)) {
+            low += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+    return low;
+}
+
+/**
+ * Index of the first key in a node that is greater than key
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+unsigned int BPlusTree<Key, Less, Order, Summarize>::upperBound(const Key* keys, unsigned int count, const K& key) const {
+    unsigned int low = 0;
+    while (count > 0) {
+        unsigned int half = count / 2;
+        if (!less(key, keys[low + half])) {
+            low += half + 1;
+            count -= half + 1;
+        }
+        else {
+            count = half;
+        }
+    }
+    return low;
+}
+
+/**
+ * Number of keys under a node
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+unsigned int BPlusTree<Key, Less, Order, Summarize>::weightOf(const NodeBase* node) {
+    if (node->leaf) {
+        return node->count;
+    }
+    const Inner* inner = static_cast<const Inner*>(node);
+    unsigned int weight = 0;
+    for (unsigned int i = 0; i <= inner->count; i++) {
+        weight += inner->weights[i];
+    }
+    return weight;
+}
+
+/**
+ * Summary of the keys under a node
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+typename BPlusTree<Key, Less, Order, Summarize>::Summary
+BPlusTree<Key, Less, Order, Summarize>::summaryOf(const NodeBase* node) const {
+    Summary summary;
+    if (node->leaf) {
+        const Leaf* leaf = static_cast<const Leaf*>(node);
+        for (unsigned int i = 0; i < leaf->count; i++) {
+            summary += summarize.Element(leaf->keys[i]);
+        }
+    }
+    else {
+        const Inner* inner = static_cast<const Inner*>(node);
+        for (unsigned int i = 0; i <= inner->count; i++) {
+            summary += inner->summaries[i];
+        }
+    }
+    return summary;
+}
+
+/**
+ * Replace the contents with already sorted keys, built bottom-up in O(n)
+ *
+ * Each level is cut into as few nodes as will hold it, with the entries
+ * spread evenly so no node ends up below the minimum fill
+ *
+ * @param sorted Keys in strictly increasing order
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+void BPlusTree<Key, Less, Order, Summarize>::BulkLoad(const std::vector<Key>& sorted) {
+    this->Clear();
+    if (sorted.empty()) {
+        return;
+    }
+
+    //the leaf level, chained as it is built
+    std::vector<NodeBase*> level;
+    std::vector<const Key*> lowest; // smallest key under each node of the level
+    std::vector<unsigned int> weight; // keys under each node of the level
+    std::vector<Summary> summary; // of the keys under each node of the level
+    size_t count = sorted.size();
+    size_t nodes = (count + Order - 1) / Order;
+    size_t next = 0;
+    Leaf* previous = nullptr;
+    for (size_t i = 0; i < nodes; i++) {
+        Leaf* leaf = new Leaf();
+        leaf->leaf = true;
+        leaf->count = (unsigned int)(count / nodes + (i < count % nodes ? 1 : 0));
+        for (unsigned int j = 0; j < leaf->count; j++) {
+            leaf->keys[j] = sorted[next++];
+        }
+        leaf->prev = previous;
+        leaf->next = nullptr;
+        if (previous != nullptr) {
+            previous->next = leaf;
+        }
+        else {
+            head = leaf;
+        }
+        previous = leaf;
+        level.push_back(leaf);
+        lowest.push_back(&leaf->keys[0]);
+        weight.push_back(leaf->count);
+        summary.push_back(this->summaryOf(leaf));
+    }
+    tail = previous;
+
+    //inner levels on top until a single root remains
+    while (level.size() > 1) {
+        std::vector<NodeBase*> parents;
+        std::vector<const Key*> parentLowest;
+        std::vector<unsigned int> parentWeight;
+        std::vector<Summary> parentSummary;
+        count = level.size();
+        nodes = (count + Order) / (Order + 1);
+        next = 0;
+        for (size_t i = 0; i < nodes; i++) {
+            Inner* inner = new Inner();
+            inner->leaf = false;
+            size_t children = count / nodes + (i < count % nodes ? 1 : 0);
+            parentLowest.push_back(lowest[next]);
+            unsigned int total = 0;
+            Summary all;
+            for (size_t j = 0; j < children; j++) {
+                if (j > 0) {
+                    inner->keys[j - 1] = *lowest[next];
+                }
+                inner->weights[j] = weight[next];
+                inner->summaries[j] = summary[next];
+                total += weight[next];
+                all += summary[next];
+                inner->children[j] = level[next++];
+            }
+            inner->count = (unsigned int)(children - 1);
+            parents.push_back(inner);
+            parentWeight.push_back(total);
+            parentSummary.push_back(all);
+        }
+        level.swap(parents);
+        lowest.swap(parentLowest);
+        weight.swap(parentWeight);
+        summary.swap(parentSummary);
+    }
+
+    root = level[0];
+    size = (unsigned int)sorted.size();
+}
+
+/**
+ * Insert a key, splitting full nodes on the way back up
+ *
+ * @param key Key to insert
+ * @return false if an equivalent key was already present
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+bool BPlusTree<Key, Less, Order, Summarize>::Insert(const Key& key) {
+    if (root == nullptr) {
+        Leaf* leaf = new Leaf();
+        leaf->count = 0;
+        leaf->leaf = true;
+        leaf->prev = nullptr;
+        leaf->next = nullptr;
+        root = head = tail = leaf;
+    }
+
+    //descend, remembering the inner nodes and the child taken in each
+    Inner* path[maxDepth];
+    unsigned int slots[maxDepth];
+    unsigned int depth = 0;
+    NodeBase* node = root;
+    while (!node->leaf) {
+        Inner* inner = static_cast<Inner*>(node);
+        unsigned int slot = this->upperBound(inner->keys, inner->count, key);
+        path[depth] = inner;
+        slots[depth] = slot;
+        depth++;
+        node = inner->children[slot];
+    }
+
+    Leaf* leaf = static_cast<Leaf*>(node);
+    unsigned int pos = this->lowerBound(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && !less(key, leaf->keys[pos])) {
+        return false;
+    }
+    size++;
+    for (unsigned int i = 0; i < depth; i++) {
+        path[i]->weights[slots[i]]++;
+        path[i]->summaries[slots[i]] += summarize.Element(key);
+    }
+
+    //split a full leaf in half and put the key in the proper half
+    Key separator;
+    NodeBase* added = nullptr;
+    if (leaf->count == Order) {
+        Leaf* right = new Leaf();
+        right->leaf = true;
+        for (unsigned int i = minCount; i < Order; i++) {
+            right->keys[i - minCount] = std::move(leaf->keys[i]);
+        }
+        right->count = Order - minCount;
+        leaf->count = minCount;
+
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next != nullptr) {
+            leaf->next->prev = right;
+        }
+        else {
+            tail = right;
+        }
+        leaf->next = right;
+
+        if (pos > minCount) {
+            pos -= minCount;
+            leaf = right;
+        }
+        added = right;
+    }
+
+    for (unsigned int i = leaf->count; i > pos; i--) {
+        leaf->keys[i] = std::move(leaf->keys[i - 1]);
+    }
+    leaf->keys[pos] = key;
+    leaf->count++;
+
+    if (added == nullptr) {
+        return true;
+    }
+    separator = static_cast<Leaf*>(added)->keys[0];
+
+    //hand the separator up, splitting full inner nodes as needed
+    while (depth > 0) {
+        depth--;
+        Inner* inner = path[depth];
+        unsigned int slot = slots[depth];
+
+        if (inner->count < Order) {
+            for (unsigned int i = inner->count; i > slot; i--) {
+                inner->keys[i] = std::move(inner->keys[i - 1]);
+                inner->children[i + 1] = inner->children[i];
+                inner->weights[i + 1] = inner->weights[i];
+                inner->summaries[i + 1] = inner->summaries[i];
+            }
+            inner->keys[slot] = std::move(separator);
+            inner->children[slot + 1] = added;
+            inner->weights[slot] = weightOf(inner->children[slot]);
+            inner->weights[slot + 1] = weightOf(added);
+            inner->summaries[slot] = this->summaryOf(inner->children[slot]);
+            inner->summaries[slot + 1] = this->summaryOf(added);
+            inner->count++;
+            return true;
+        }
+
+        //gather the Order + 1 keys, keep the lower half, move up the middle
+        Key keys[Order + 1];
+        NodeBase* children[Order + 2];
+        unsigned int weights[Order + 2];
+        Summary summaries[Order + 2];
+        for (unsigned int i = 0, j = 0; i <= Order; i++) {
+            if (i == slot) {
+                keys[i] = std::move(separator);
+            }
+            else {
+                keys[i] = std::move(inner->keys[j++]);
+            }
+        }
+        for (unsigned int i = 0, j = 0; i <= Order + 1; i++) {
+            if (i == slot + 1) {
+                children[i] = added;
+                weights[i] = weightOf(added);
+                summaries[i] = this->summaryOf(added);
+            }
+            else {
+                weights[i] = inner->weights[j];
+                summaries[i] = inner->summaries[j];
+                children[i] = inner->children[j++];
+            }
+        }
+        weights[slot] = weightOf(children[slot]);
+        summaries[slot] = this->summaryOf(children[slot]);
+
+        Inner* right = new Inner();
+        right->leaf = false;
+        unsigned int middle = (Order + 1) / 2;
+        for (unsigned int i = 0; i < middle; i++) {
+            inner->keys[i] = std::move(keys[i]);
+            inner->children[i] = children[i];
+            inner->weights[i] = weights[i];
+            inner->summaries[i] = summaries[i];
+        }
+        inner->children[middle] = children[middle];
+        inner->weights[middle] = weights[middle];
+        inner->summaries[middle] = summaries[middle];
+        inner->count = middle;
+
+        for (unsigned int i = middle + 1; i <= Order; i++) {
+            right->keys[i - middle - 1] = std::move(keys[i]);
+            right->children[i - middle - 1] = children[i];
+            right->weights[i - middle - 1] = weights[i];
+            right->summaries[i - middle - 1] = summaries[i];
+        }
+        right->children[Order - middle] = children[Order + 1];
+        right->weights[Order - middle] = weights[Order + 1];
+        right->summaries[Order - middle] = summaries[Order + 1];
+        right->count = Order - middle;
+
+        separator = std::move(keys[middle]);
+        added = right;
+    }
+
+    //the root itself split, so grow the tree by one level
+    Inner* top = new Inner();
+    top->leaf = false;
+    top->count = 1;
+    top->keys[0] = std::move(separator);
+    top->children[0] = root;
+    top->children[1] = added;
+    top->weights[0] = weightOf(root);
+    top->weights[1] = weightOf(added);
+    top->summaries[0] = this->summaryOf(root);
+    top->summaries[1] = this->summaryOf(added);
+    root = top;
+    return true;
+}
+
+/**
+ * Remove a key, borrowing from or merging with siblings on underflow
+ *
+ * @param key Key to remove
+ * @return true if the key was found and removed
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+bool BPlusTree<Key, Less, Order, Summarize>::Remove(const Key& key) {
+    if (root == nullptr) {
+        return false;
+    }
+
+    Inner* path[maxDepth];
+    unsigned int slots[maxDepth];
+    unsigned int depth = 0;
+    NodeBase* node = root;
+    while (!node->leaf) {
+        Inner* inner = static_cast<Inner*>(node);
+        unsigned int slot = this->upperBound(inner->keys, inner->count, key);
+        path[depth] = inner;
+        slots[depth] = slot;
+        depth++;
+        node = inner->children[slot];
+    }
+
+    Leaf* leaf = static_cast<Leaf*>(node);
+    unsigned int pos = this->lowerBound(leaf->keys, leaf->count, key);
+    if (pos == leaf->count || less(key, leaf->keys[pos])) {
+        return false;
+    }
+
+    for (unsigned int i = pos + 1; i < leaf->count; i++) {
+        leaf->keys[i - 1] = std::move(leaf->keys[i]);
+    }
+    leaf->count--;
+    size--;
+    for (unsigned int i = 0; i < depth; i++) {
+        path[i]->weights[slots[i]]--;
+    }
+
+    //a summary cannot take a key back out, so redo the path bottom-up
+    const NodeBase* changed = leaf;
+    for (unsigned int i = depth; i > 0; i--) {
+        path[i - 1]->summaries[slots[i - 1]] = this->summaryOf(changed);
+        changed = path[i - 1];
+    }
+
+    //a removed first key can live on as the separator just left of the
+    //path; keys may point at storage the caller frees afterwards, so
+    //that separator takes the leaf's new first key instead
+    if (pos == 0 && leaf->count > 0) {
+        for (unsigned int level = depth; level > 0; level--) {
+            if (slots[level - 1] > 0) {
+                Key& separator = path[level - 1]->keys[slots[level - 1] - 1];
+                if (!less(separator, key)) {
+                    separator = leaf->keys[0];
+                }
+                break;
+            }
+        }
+    }
+
+    this->rebalance(path, slots, depth, leaf);
+    return true;
+}
+
+/**
+ * Fix underfull nodes from a leaf up towards the root
+ *
+ * @param path Inner nodes visited on the way down
+ * @param slots Child index taken in each of those inner nodes
+ * @param depth Number of entries in path
+ * @param node Node that just lost a key
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+void BPlusTree<Key, Less, Order, Summarize>::rebalance(Inner** path, unsigned int* slots, unsigned int depth, NodeBase* node) {
+    while (depth > 0 && node->count < minCount) {
+        Inner* parent = path[depth - 1];
+        unsigned int slot = slots[depth - 1];
+        NodeBase* left = (slot > 0) ? parent->children[slot - 1] : nullptr;
+        NodeBase* right = (slot < parent->count) ? parent->children[slot + 1] : nullptr;
+
+        if (node->leaf) {
+            Leaf* leaf = static_cast<Leaf*>(node);
+
+            //borrow the last key of the left sibling
+            if (left != nullptr && left->count > minCount) {
+                Leaf* from = static_cast<Leaf*>(left);
+                for (unsigned int i = leaf->count; i > 0; i--) {
+                    leaf->keys[i] = std::move(leaf->keys[i - 1]);
+                }
+                leaf->keys[0] = std::move(from->keys[--from->count]);
+                leaf->count++;
+                parent->keys[slot - 1] = leaf->keys[0];
+                parent->weights[slot - 1]--;
+                parent->weights[slot]++;
+                parent->summaries[slot - 1] = this->summaryOf(from);
+                parent->summaries[slot] += summarize.Element(leaf->keys[0]);
+                return;
+            }
+
+            //borrow the first key of the right sibling
+            if (right != nullptr && right->count > minCount) {
+                Leaf* from = static_cast<Leaf*>(right);
+                leaf->keys[leaf->count++] = std::move(from->keys[0]);
+                for (unsigned int i = 1; i < from->count; i++) {
+                    from->keys[i - 1] = std::move(from->keys[i]);
+                }
+                from->count--;
+                parent->keys[slot] = from->keys[0];
+                parent->weights[slot]++;
+                parent->weights[slot + 1]--;
+                parent->summaries[slot] += summarize.Element(leaf->keys[leaf->count - 1]);
+                parent->summaries[slot + 1] = this->summaryOf(from);
+                return;
+            }
+
+            //merge with a sibling, the right one of the pair goes away
+            if (left == nullptr) {
+                slot++;
+                left = leaf;
+            }
+            Leaf* into = static_cast<Leaf*>(left);
+            Leaf* gone = static_cast<Leaf*>(parent->children[slot]);
+            for (unsigned int i = 0; i < gone->count; i++) {
+                into->keys[into->count + i] = std::move(gone->keys[i]);
+            }
+            into->count += gone->count;
+            into->next = gone->next;
+            if (gone->next != nullptr) {
+                gone->next->prev = into;
+            }
+            else {
+                tail = into;
+            }
+            delete gone;
+        }
+        else {
+            Inner* inner = static_cast<Inner*>(node);
+
+            //rotate a key through the parent from the left sibling
+            if (left != nullptr && left->count > minCount) {
+                Inner* from = static_cast<Inner*>(left);
+                inner->children[inner->count + 1] = inner->children[inner->count];
+                inner->weights[inner->count + 1] = inner->weights[inner->count];
+                inner->summaries[inner->count + 1] = inner->summaries[inner->count];
+                for (unsigned int i = inner->count; i > 0; i--) {
+                    inner->keys[i] = std::move(inner->keys[i - 1]);
+                    inner->children[i] = inner->children[i - 1];
+                    inner->weights[i] = inner->weights[i - 1];
+                    inner->summaries[i] = inner->summaries[i - 1];
+                }
+                inner->keys[0] = std::move(parent->keys[slot - 1]);
+                inner->children[0] = from->children[from->count];
+                inner->weights[0] = from->weights[from->count];
+                inner->summaries[0] = from->summaries[from->count];
+                parent->weights[slot - 1] -= inner->weights[0];
+                parent->weights[slot] += inner->weights[0];
+                parent->summaries[slot] += inner->summaries[0];
+                inner->count++;
+                parent->keys[slot - 1] = std::move(from->keys[--from->count]);
+                parent->summaries[slot - 1] = this->summaryOf(from);
+                return;
+            }
+
+            //rotate a key through the parent from the right sibling
+            if (right != nullptr && right->count > minCount) {
+                Inner* from = static_cast<Inner*>(right);
+                inner->keys[inner->count] = std::move(parent->keys[slot]);
+                inner->children[inner->count + 1] = from->children[0];
+                inner->weights[inner->count + 1] = from->weights[0];
+                inner->summaries[inner->count + 1] = from->summaries[0];
+                parent->weights[slot] += from->weights[0];
+                parent->weights[slot + 1] -= from->weights[0];
+                parent->summaries[slot] += from->summaries[0];
+                inner->count++;
+                parent->keys[slot] = std::move(from->keys[0]);
+                for (unsigned int i = 1; i < from->count; i++) {
+                    from->keys[i - 1] = std::move(from->keys[i]);
+                }
+                for (unsigned int i = 1; i <= from->count; i++) {
+                    from->children[i - 1] = from->children[i];
+                    from->weights[i - 1] = from->weights[i];
+                    from->summaries[i - 1] = from->summaries[i];
+                }
+                from->count--;
+                parent->summaries[slot + 1] = this->summaryOf(from);
+                return;
+            }
+
+            //merge with a sibling, pulling the separator down between them
+            if (left == nullptr) {
+                slot++;
+                left = inner;
+            }
+            Inner* into = static_cast<Inner*>(left);
+            Inner* gone = static_cast<Inner*>(parent->children[slot]);
+            into->keys[into->count] = std::move(parent->keys[slot - 1]);
+            for (unsigned int i = 0; i < gone->count; i++) {
+                into->keys[into->count + 1 + i] = std::move(gone->keys[i]);
+            }
+            for (unsigned int i = 0; i <= gone->count; i++) {
+                into->children[into->count + 1 + i] = gone->children[i];
+                into->weights[into->count + 1 + i] = gone->weights[i];
+                into->summaries[into->count + 1 + i] = gone->summaries[i];
+            }
+            into->count += gone->count + 1;
+            delete gone;
+        }
+
+        //drop the separator and the merged-away child from the parent
+        parent->weights[slot - 1] += parent->weights[slot];
+        parent->summaries[slot - 1] += parent->summaries[slot];
+        for (unsigned int i = slot; i < parent->count; i++) {
+            parent->keys[i - 1] = std::move(parent->keys[i]);
+            parent->children[i] = parent->children[i + 1];
+            parent->weights[i] = parent->weights[i + 1];
+            parent->summaries[i] = parent->summaries[i + 1];
+        }
+        parent->count--;
+
+        node = parent;
+        depth--;
+    }
+
+    //shrink the tree when the root runs out of keys
+    if (root->leaf) {
+        if (root->count == 0) {
+            delete static_cast<Leaf*>(root);
+            root = nullptr;
+            head = nullptr;
+            tail = nullptr;
+        }
+    }
+    else if (root->count == 0) {
+        Inner* old = static_cast<Inner*>(root);
+        root = old->children[0];
+        delete old;
+    }
+}
+
+/**
+ * Position of the smallest key
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+typename BPlusTree<Key, Less, Order, Summarize>::Position BPlusTree<Key, Less, Order, Summarize>::Begin() const {
+    return Position(head, 0);
+}
+
+/**
+ * Position of the largest key
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+typename BPlusTree<Key, Less, Order, Summarize>::Position BPlusTree<Key, Less, Order, Summarize>::Last() const {
+    return Position(tail, (tail != nullptr) ? tail->count - 1 : 0);
+}
+
+/**
+ * Position of the first key that is not less than key
+ *
+ * The key can also be of any type K that Less compares against Key
+ * both ways, which finds the first of all the keys equivalent to it
+ *
+ * @param key Key to search for
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+typename BPlusTree<Key, Less, Order, Summarize>::Position BPlusTree<Key, Less, Order, Summarize>::LowerBound(const K& key) const {
+    NodeBase* node = root;
+    if (node == nullptr) {
+        return Position();
+    }
+
+    //keys equivalent to key may sit left of an equivalent separator,
+    //so only step right past separators that are strictly less
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        node = inner->children[this->lowerBound(inner->keys, inner->count, key)];
+    }
+
+    Leaf* leaf = static_cast<Leaf*>(node);
+    unsigned int pos = this->lowerBound(leaf->keys, leaf->count, key);
+    if (pos == leaf->count) {
+        return Position(leaf->next, 0);
+    }
+    return Position(leaf, pos);
+}
+
+/**
+ * Position of the first key that is greater than key
+ *
+ * @param key Key, or anything Less compares against keys, to search for
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+typename BPlusTree<Key, Less, Order, Summarize>::Position BPlusTree<Key, Less, Order, Summarize>::UpperBound(const K& key) const {
+    NodeBase* node = root;
+    if (node == nullptr) {
+        return Position();
+    }
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        node = inner->children[this->upperBound(inner->keys, inner->count, key)];
+    }
+
+    Leaf* leaf = static_cast<Leaf*>(node);
+    unsigned int pos = this->upperBound(leaf->keys, leaf->count, key);
+    if (pos == leaf->count) {
+        return Position(leaf->next, 0);
+    }
+    return Position(leaf, pos);
+}
+
+/**
+ * Number of keys less than key
+ *
+ * @param key Key, or anything Less compares against keys, to count below
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+unsigned int BPlusTree<Key, Less, Order, Summarize>::CountBelow(const K& key) const {
+    //descend as LowerBound does, adding up the children passed over
+    unsigned int below = 0;
+    const NodeBase* node = root;
+    if (node == nullptr) {
+        return 0;
+    }
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        unsigned int slot = this->lowerBound(inner->keys, inner->count, key);
+        for (unsigned int i = 0; i < slot; i++) {
+            below += inner->weights[i];
+        }
+        node = inner->children[slot];
+    }
+    const Leaf* leaf = static_cast<const Leaf*>(node);
+    return below + this->lowerBound(leaf->keys, leaf->count, key);
+}
+
+/**
+ * Number of keys not greater than key
+ *
+ * @param key Key, or anything Less compares against keys, to count up to
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+unsigned int BPlusTree<Key, Less, Order, Summarize>::CountUpTo(const K& key) const {
+    unsigned int upTo = 0;
+    const NodeBase* node = root;
+    if (node == nullptr) {
+        return 0;
+    }
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        unsigned int slot = this->upperBound(inner->keys, inner->count, key);
+        for (unsigned int i = 0; i < slot; i++) {
+            upTo += inner->weights[i];
+        }
+        node = inner->children[slot];
+    }
+    const Leaf* leaf = static_cast<const Leaf*>(node);
+    return upTo + this->upperBound(leaf->keys, leaf->count, key);
+}
+
+/**
+ * Position of the key at an index in the order, counting from 0
+ *
+ * @param index Position of the key
+ * @return the position, not valid when index is not below Size()
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+typename BPlusTree<Key, Less, Order, Summarize>::Position BPlusTree<Key, Less, Order, Summarize>::Select(unsigned int index) const {
+    if (index >= size) {
+        return Position();
+    }
+    NodeBase* node = root;
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        unsigned int slot = 0;
+        while (index >= inner->weights[slot]) {
+            index -= inner->weights[slot++];
+        }
+        node = inner->children[slot];
+    }
+    return Position(static_cast<Leaf*>(node), index);
+}
+
+/**
+ * Summary of the keys from low to high, both included
+ *
+ * @param low Low end of the range, a key or anything Less compares against keys
+ * @param high High end of the range
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+typename BPlusTree<Key, Less, Order, Summarize>::Summary
+BPlusTree<Key, Less, Order, Summarize>::SummarizeBetween(const K& low, const K& high) const {
+    Summary total;
+    const NodeBase* node = root;
+    if (node == nullptr) {
+        return total;
+    }
+
+    //descend while both ends fall under the same child; once they part,
+    //the children between them count whole and only the two edges are
+    //followed down further
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        unsigned int first = this->lowerBound(inner->keys, inner->count, low);
+        unsigned int last = this->upperBound(inner->keys, inner->count, high);
+        if (first > last) {
+            return total;
+        }
+        if (first < last) {
+            for (unsigned int i = first + 1; i < last; i++) {
+                total += inner->summaries[i];
+            }
+            this->summarizeFrom(inner->children[first], low, total);
+            this->summarizeUpTo(inner->children[last], high, total);
+            return total;
+        }
+        node = inner->children[first];
+    }
+
+    const Leaf* leaf = static_cast<const Leaf*>(node);
+    unsigned int last = this->upperBound(leaf->keys, leaf->count, high);
+    for (unsigned int i = this->lowerBound(leaf->keys, leaf->count, low); i < last; i++) {
+        total += summarize.Element(leaf->keys[i]);
+    }
+    return total;
+}
+
+/**
+ * Add the keys under a node that are not less than low
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+void BPlusTree<Key, Less, Order, Summarize>::summarizeFrom(const NodeBase* node, const K& low, Summary& total) const {
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        unsigned int slot = this->lowerBound(inner->keys, inner->count, low);
+        for (unsigned int i = slot + 1; i <= inner->count; i++) {
+            total += inner->summaries[i];
+        }
+        node = inner->children[slot];
+    }
+    const Leaf* leaf = static_cast<const Leaf*>(node);
+    for (unsigned int i = this->lowerBound(leaf->keys, leaf->count, low); i < leaf->count; i++) {
+        total += summarize.Element(leaf->keys[i]);
+    }
+}
+
+/**
+ * Add the keys under a node that are not greater than high
+ */
+template <typename Key, typename Less, unsigned int Order, typename Summarize>
+template <typename K>
+void BPlusTree<Key, Less, Order, Summarize>::summarizeUpTo(const NodeBase* node, const K& high, Summary& total) const {
+    while (!node->leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        unsigned int slot = this->upperBound(inner->keys, inner->count, high);
+        for (unsigned int i = 0; i < slot; i++) {
+            total += inner->summaries[i];
+        }
+        node = inner->children[slot];
+    }
+    const Leaf* leaf = static_cast<const Leaf*>(node);
+    unsigned int last = this->upperBound(leaf->keys, leaf->count, high);
+    for (unsigned int i = 0; i < last; i++) {
+        total += summarize.Element(leaf->keys[i]);
+    }
+}
+
+#endif /*!_BPLUSTREE_HPP_*/
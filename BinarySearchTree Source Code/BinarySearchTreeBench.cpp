@@ -0,0 +1,729 @@
+//============================================================================
+// Name        : BinarySearchTreeBench.cpp
+// Author      : John Austin
+// Version     : 1.0
+// Copyright   : Copyright © 2017 SNHU COCE
+// Description : Timings of the bid tree and the CSV readers on generated bids
+//============================================================================
+
+// the tree is built into this program, without its menu
+#define BINARYSEARCHTREE_NO_MAIN
+#include "JohnAustinBinarySearchTree.cpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# define NOMINMAX
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <unistd.h>
+#endif
+
+//============================================================================
+// Timing and reporting
+//============================================================================
+
+typedef std::chrono::steady_clock Clock;
+
+// results fold into this so the compiler cannot drop the work timed
+static volatile size_t sink = 0;
+
+/**
+ * Seconds from a start time until now
+ *
+ * @param start When the timed work began
+ */
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/**
+ * Shortest of several timed runs of the same work, the one least
+ * disturbed by whatever else the machine was doing
+ *
+ * @param runs How many times to run it
+ * @param work The work to time
+ */
+template <typename Work>
+static double bestOf(int runs, Work work) {
+    double best = 0;
+    for (int run = 0; run < runs; run++) {
+        Clock::time_point start = Clock::now();
+        work();
+        double seconds = secondsSince(start);
+        if (run == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+/**
+ * Memory the process has resident right now, or 0 where that is not known
+ */
+static size_t residentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+#else
+    //second field of statm is the resident size in pages
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0;
+    size_t resident = 0;
+    if (statm >> pages >> resident) {
+        return resident * (size_t)sysconf(_SC_PAGESIZE);
+    }
+    return 0;
+#endif
+}
+
+/**
+ * Print one measurement, lined up with the others
+ *
+ * @param label What was measured
+ * @param value The measurement
+ * @param unit Unit of the measurement
+ */
+static void report(const string& label, double value, const char* unit) {
+    char line[128];
+    std::snprintf(line, sizeof(line), "  %-44s %12.2f %s", label.c_str(), value, unit);
+    std::cout << line << endl;
+}
+
+/**
+ * Name of a backend as the reports show it
+ *
+ * @param backend Backend to name
+ */
+static const char* backendName(TreeBackend backend) {
+    return (backend == B_PLUS) ? "B+" : "red-black";
+}
+
+//============================================================================
+// Generated bids
+//============================================================================
+
+/**
+ * A bid with a numeric id and the given winning amount in cents
+ *
+ * @param id Auction id
+ * @param cents Winning amount
+ */
+static Bid makeBid(unsigned int id, int64_t cents) {
+    Bid bid;
+    bid.bidId = std::to_string(id);
+    bid.title = "Item " + bid.bidId;
+    bid.amount = Cents(cents);
+    return bid;
+}
+
+/**
+ * Bids with consecutive ids, in the order an export would list them
+ *
+ * Amounts are whole dollars up to $5,000, so many bids share one the
+ * way they do in the real exports
+ *
+ * @param count How many bids
+ * @param firstId Id of the first bid in id order
+ * @param order 0 for ascending ids, 1 for descending, 2 for shuffled
+ * @param seed Seed of the amounts and the shuffle
+ */
+static vector<Bid> generateBids(unsigned int count, unsigned int firstId, int order, unsigned int seed) {
+    std::mt19937 random(seed);
+    vector<Bid> bids;
+    bids.reserve(count);
+    for (unsigned int i = 0; i < count; i++) {
+        bids.push_back(makeBid(firstId + i, (random() % 5000 + 1) * 100));
+    }
+    if (order == 1) {
+        std::reverse(bids.begin(), bids.end());
+    }
+    else if (order == 2) {
+        std::shuffle(bids.begin(), bids.end(), random);
+    }
+    return bids;
+}
+
+// header of the eBid_Monthly_Sales.csv export the generated ones copy
+static const char* const exportHeader =
+    "Auction Title ,Auction ID,Department ,Close Date ,Winning Bid ,CC Fee,Fee Percent,"
+    "Auction Fee Subtotal,Auction Fee Total,Pay Status ,Paid Date ,Asset #,Inventory ID,"
+    "Decal /Vehicle ID,VTR Number,Receipt Number ,Cap,Expenses,Net Sales,Fund,Business Unit";
+
+/**
+ * A whole export in the shape of eBid_Monthly_Sales.csv, ids ascending
+ *
+ * Rows come out about as long as the real ones; some titles are quoted
+ * with commas and doubled quotes in them, and some inventory columns
+ * are long quoted lists, as in the real file. No field holds a newline,
+ * so the lines can also be split the way the old parser split them
+ *
+ * @param rows How many bids
+ * @param seed Seed of the generated fields
+ */
+static string generateExport(unsigned int rows, unsigned int seed) {
+    const char* titles[] = { "Dell Laptop w/Bag", "Men's Diamond Watch", "10Kt Yellow Gold Rope Chain",
+        "\"Lot of 3, HP Printers\"", "\"4 Asanti 24\"\" Chrome Rims\"", "2004 Ford Crown Victoria" };
+    const char* departments[] = { "ITS", "DRUG TASK FORCE", "POLICE", "FLEET" };
+    const char* funds[] = { "Enterprise", "General Fund", "" };
+    std::mt19937 random(seed);
+
+    string text = exportHeader;
+    text += '\n';
+    char line[512];
+    for (unsigned int row = 0; row < rows; row++) {
+        unsigned int cents = (unsigned int)(random() % 500000 + 1);
+        string inventory = std::to_string(70000 + random() % 10000);
+        if (random() % 8 == 0) {
+            inventory = "\"" + inventory;
+            for (int more = random() % 20; more > 0; more--) {
+                inventory += ", " + std::to_string(70000 + random() % 10000);
+            }
+            inventory += "\"";
+        }
+        std::snprintf(line, sizeof(line),
+            "%s,%u,%s,11/%02u/2013,$%u.%02u,$%u.%02u,0.23,$%u.%02u,$%u.%02u,Successful,01/03/2014,,%s,,,%u,$3000,$0.00,$%u.%02u,%s,0\n",
+            titles[random() % 6], 10000 + row, departments[random() % 4], (unsigned int)(random() % 28 + 1),
+            cents / 100, cents % 100, cents / 4300, cents / 43 % 100, cents * 23 / 10000, cents * 23 / 100 % 100,
+            cents * 23 / 10000, cents * 23 / 100 % 100, inventory.c_str(), (unsigned int)(3600000000u + random() % 10000000),
+            cents * 77 / 10000, cents * 77 / 100 % 100, funds[random() % 3]);
+        text += line;
+    }
+    return text;
+}
+
+/**
+ * Write a generated file, replacing any earlier one
+ *
+ * @param path Where to write it
+ * @param text Whole contents, written as is
+ */
+static void writeFile(const string& path, const string& text) {
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(text.data(), text.size());
+}
+
+//============================================================================
+// Benchmarks
+//============================================================================
+
+/**
+ * Inserting an export one bid at a time in id order, the input that
+ * made the unbalanced tree quadratic, against the same bids reversed
+ * and shuffled, then searching for every one of them
+ */
+static void benchSortedAndShuffledLoad() {
+    const unsigned int count = 30000;
+    const char* orders[] = { "sorted", "reverse sorted", "shuffled" };
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        for (int order = 0; order < 3; order++) {
+            vector<Bid> bids = generateBids(count, 10000, order, 1);
+            vector<string> ids;
+            for (const Bid& bid : bids) {
+                ids.push_back(bid.bidId);
+            }
+
+            BinarySearchTree bst(backend);
+            Clock::time_point start = Clock::now();
+            for (Bid& bid : bids) {
+                bst.Insert(std::move(bid));
+            }
+            double insert = secondsSince(start);
+
+            start = Clock::now();
+            size_t found = 0;
+            for (const string& id : ids) {
+                found += !bst.BidSearch(id).bidId.empty();
+            }
+            double search = secondsSince(start);
+            sink += found;
+
+            string label = string(backendName(backend)) + ", " + orders[order];
+            report(label + " insert", insert * 1e3, "ms");
+            report(label + " search all", search * 1e3, "ms");
+        }
+    }
+}
+
+/**
+ * Amount range queries on a narrow and a wide window, against walking
+ * every bid in amount order and keeping those in the window, which is
+ * what visiting every node of the amount tree cost
+ */
+static void benchAmountRanges() {
+    const unsigned int count = 100000;
+    const int queries = 1000;
+    const struct {
+        const char* name;
+        int64_t width; // in cents
+    } windows[] = {
+        { "narrow ($1)", 100 },
+        { "wide (half the amounts)", 250000 },
+    };
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        for (Bid& bid : generateBids(count, 10000, 2, 2)) {
+            bst.Insert(std::move(bid));
+        }
+
+        for (const auto& window : windows) {
+            std::mt19937 random(3);
+            vector<Cents> lows;
+            for (int i = 0; i < queries; i++) {
+                lows.push_back(Cents(random() % (500000 - window.width) + 1));
+            }
+
+            Clock::time_point start = Clock::now();
+            size_t visited = 0;
+            for (Cents low : lows) {
+                bst.AmountSearch(low, Cents(low.value + window.width), [&visited](const Bid&) { visited++; });
+            }
+            double search = secondsSince(start);
+
+            //the scan is slow enough that a tenth of the queries will do
+            start = Clock::now();
+            for (int i = 0; i < queries / 10; i++) {
+                Cents low = lows[i];
+                Cents high(low.value + window.width);
+                bst.InAmountOrder([&visited, low, high](const Bid& bid) {
+                    visited += (bid.amount >= low && bid.amount <= high);
+                });
+            }
+            double scan = secondsSince(start) * 10;
+            sink += visited;
+
+            string label = string(backendName(backend)) + ", " + window.name;
+            report(label + " search", search * 1e6 / queries, "us");
+            report(label + " full scan", scan * 1e6 / queries, "us");
+        }
+    }
+}
+
+/**
+ * Splitting the records of a large export into fields: the per-character
+ * loop Parser::parseContent had, with a bounds-checked at() on every
+ * byte, against splitRecord, which finds separators and quotes a block
+ * at a time; then the readers over the same export as a file, on one
+ * thread and on more, up to one per core
+ */
+static void benchTokenizer() {
+    const unsigned int rows = 200000;
+    const char* path = "bench_export.csv";
+    string text = generateExport(rows, 4);
+    double megabytes = text.size() / 1e6;
+
+    vector<string> lines;
+    std::istringstream stream(text);
+    string line;
+    std::getline(stream, line); // header
+    while (std::getline(stream, line)) {
+        lines.push_back(line);
+    }
+
+    //the old loop, cutting views instead of strings so only the scan is timed
+    vector<string_view> fields;
+    size_t count = 0;
+    double loop = bestOf(3, [&]() {
+        for (const string& it : lines) {
+            bool quoted = false;
+            int tokenStart = 0;
+            unsigned int i = 0;
+            fields.clear();
+            for (; i != it.length(); i++) {
+                if (it.at(i) == '"')
+                    quoted = ((quoted) ? (false) : (true));
+                else if (it.at(i) == ',' && !quoted) {
+                    fields.push_back(string_view(it).substr(tokenStart, i - tokenStart));
+                    tokenStart = i + 1;
+                }
+            }
+            fields.push_back(string_view(it).substr(tokenStart, it.length() - tokenStart));
+            count += fields.size();
+        }
+    });
+
+    double split = bestOf(3, [&]() {
+        for (const string& it : lines) {
+            csv::splitRecord(it, ',', fields);
+            count += fields.size();
+        }
+    });
+
+    report("per-character loop", megabytes / loop, "MB/s");
+    report("splitRecord", megabytes / split, "MB/s");
+
+    //both readers split the file across threads, up to one per core
+    vector<unsigned int> threadCounts = { 1, 2, 4 };
+    unsigned int cores = std::thread::hardware_concurrency();
+    if (cores > 4) {
+        threadCounts.push_back(cores);
+    }
+
+    writeFile(path, text);
+    for (unsigned int threads : threadCounts) {
+        double mapped = bestOf(3, [&]() {
+            csv::MappedParser parser(path, ',', threads);
+            count += parser.rowCount();
+        });
+        double streamed = bestOf(3, [&]() {
+            csv::Reader reader(path, ',', threads);
+            while (reader.next(fields)) {
+                count += fields.size();
+            }
+        });
+
+        string label = ", whole file, " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+        report("MappedParser" + label, megabytes / mapped, "MB/s");
+        report("Reader" + label, megabytes / streamed, "MB/s");
+    }
+    std::remove(path);
+    sink += count;
+}
+
+/**
+ * Id lookups and amount order scans in the two backends, at the size
+ * of eBid_Monthly_Sales.csv and at a million bids, with random 8-digit
+ * ids so lookups land all over the index
+ */
+static void benchBackends() {
+    const int lookups = 200000;
+
+    for (unsigned int count : { 17937u, 1000000u }) {
+        std::mt19937 random(5);
+        vector<Bid> bids;
+        for (unsigned int i = 0; i < count; i++) {
+            bids.push_back(makeBid((unsigned int)(10000000 + random() % 90000000), (random() % 5000 + 1) * 100));
+        }
+        vector<string> ids;
+        for (int i = 0; i < lookups; i++) {
+            ids.push_back(bids[random() % count].bidId);
+        }
+
+        for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+            BinarySearchTree bst(backend);
+            size_t next = 0;
+            vector<Bid> copies(bids);
+            bst.BulkLoad([&copies, &next](Bid& bid) {
+                if (next == copies.size()) {
+                    return false;
+                }
+                bid = std::move(copies[next++]);
+                return true;
+            });
+
+            //lower bounds, so the time is the search and not a copy of the bid
+            size_t found = 0;
+            double lookup = bestOf(3, [&]() {
+                for (const string& id : ids) {
+                    found += bst.BidLowerBound(id) != bst.BidEnd();
+                }
+            });
+
+            int64_t total = 0;
+            double scan = bestOf(3, [&]() {
+                for (auto it = bst.AmountBegin(), end = bst.AmountEnd(); it != end; ++it) {
+                    total += it.Amount().value;
+                }
+            });
+            sink += found + (size_t)total;
+
+            string label = string(backendName(backend)) + ", " + std::to_string(count) + " bids";
+            report(label + " lookup", lookup * 1e9 / lookups, "ns");
+            report(label + " amount scan", count / scan / 1e6, "Mkeys/s");
+        }
+    }
+}
+
+/**
+ * BidLowerBound with ids that are numbers, compared as integers, against
+ * the same ids with a letter in front, which fall back to comparing
+ * text, in both backends and frozen. BidSearch would time copying the
+ * bid out as well, which hides the search itself
+ */
+static void benchIdLookups() {
+    const unsigned int count = 100000;
+    const int lookups = 200000;
+
+    for (bool numeric : { true, false }) {
+        std::mt19937 random(6);
+        vector<Bid> bids;
+        for (unsigned int i = 0; i < count; i++) {
+            bids.push_back(makeBid((unsigned int)(10000000 + random() % 90000000), 100));
+            if (!numeric) {
+                bids.back().bidId.insert(0, 1, 'A');
+            }
+        }
+        vector<string> ids;
+        for (int i = 0; i < lookups; i++) {
+            ids.push_back(bids[random() % count].bidId);
+        }
+
+        for (int layout = 0; layout < 3; layout++) {
+            BinarySearchTree bst(layout == 1 ? B_PLUS : RED_BLACK);
+            for (const Bid& bid : bids) {
+                bst.Insert(bid);
+            }
+            if (layout == 2) {
+                bst.Freeze();
+            }
+
+            size_t found = 0;
+            double lookup = bestOf(3, [&]() {
+                for (const string& id : ids) {
+                    found += (bst.BidLowerBound(id) != bst.BidEnd());
+                }
+            });
+            sink += found;
+
+            const char* layouts[] = { "red-black", "B+", "frozen" };
+            string label = string(layouts[layout]) + (numeric ? ", numeric ids" : ", text ids");
+            report(label + " search", lookup * 1e9 / lookups, "ns");
+        }
+    }
+}
+
+/**
+ * Loading a large export with csv::Parser, which keeps every line and
+ * every field as strings: how long it takes, how much memory it holds
+ * on to, and reading a field back from every row
+ *
+ * The memory is how much the resident set grows, which earlier
+ * benchmarks can hide by leaving freed memory behind, so run this one
+ * on its own for that figure
+ */
+static void benchParserLoad() {
+    const unsigned int rows = 200000;
+    const char* path = "bench_export.csv";
+    string text = generateExport(rows, 7);
+    writeFile(path, text);
+    double megabytes = text.size() / 1e6;
+    string().swap(text);
+
+    size_t before = residentBytes();
+    Clock::time_point start = Clock::now();
+    {
+        csv::Parser parser(path);
+        double load = secondsSince(start);
+        size_t held = residentBytes() - before;
+
+        size_t length = 0;
+        double access = bestOf(3, [&]() {
+            for (unsigned int row = 0; row < parser.rowCount(); row++) {
+                length += parser[row]["Winning Bid "].size();
+            }
+        });
+        sink += length;
+
+        report("load " + std::to_string(rows) + " rows", load * 1e3, "ms");
+        report("load", megabytes / load, "MB/s");
+        report("memory held", held / 1e6, "MB");
+        report("memory held per row", (double)held / rows, "bytes");
+        report("field by column name", access * 1e9 / rows, "ns");
+    }
+    std::remove(path);
+}
+
+/**
+ * Dumping every bid in id order to a file, one stream insertion per
+ * field and endl per bid the way inBidOrder used to, against BidWriter
+ * formatting into its buffer and writing it out in large blocks
+ */
+static void benchFullDump() {
+    const unsigned int count = 200000;
+    const char* path = "bench_dump.txt";
+
+    BinarySearchTree bst;
+    uint32_t fund = fundNames.Intern("General Fund");
+    for (Bid& bid : generateBids(count, 10000, 2, 8)) {
+        bid.fund = fund;
+        bst.Insert(std::move(bid));
+    }
+
+    double streamed = bestOf(3, [&]() {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        bst.InBidOrder([&out](const Bid& bid) {
+            out << bid.bidId << ": " << bid.title << "| " << bid.amount << "| "
+                << fundNames[bid.fund] << endl;
+        });
+    });
+
+    double buffered = bestOf(3, [&]() {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        BidWriter writer(out);
+        bst.InBidOrder([&writer](const Bid& bid) { writer.Write(bid); });
+    });
+    std::remove(path);
+
+    report("endl per bid", streamed * 1e3, "ms");
+    report("BidWriter", buffered * 1e3, "ms");
+}
+
+/**
+ * Loading a whole export against loads that keep about a third and
+ * about one in a hundred of its rows, which test the raw fields and
+ * never build a Bid for the rows they drop
+ */
+static void benchFilteredLoad() {
+    const unsigned int rows = 200000;
+    const char* path = "bench_filtered.csv";
+    writeFile(path, generateExport(rows, 11));
+
+    const struct {
+        const char* label;
+        vector<const char*> conditions;
+    } loads[] = {
+        { "full load", {} },
+        { "Fund == Enterprise", { "Fund == Enterprise" } },
+        { "Winning Bid >= 4950", { "Winning Bid >= 4950" } },
+    };
+
+    //loadBids shows the header of every load, which is not timed here
+    std::streambuf* shown = std::cout.rdbuf(nullptr);
+    vector<std::pair<string, double>> results;
+    for (bool lazy : { false, true }) {
+        for (const auto& load : loads) {
+            vector<BidCondition> conditions;
+            for (const char* text : load.conditions) {
+                conditions.push_back(BidCondition());
+                parseCondition(text, conditions.back());
+            }
+            size_t kept = 0;
+            double seconds = bestOf(3, [&]() {
+                BinarySearchTree bst;
+                loadBids(path, &bst, conditions, lazy);
+                kept = bst.Size();
+            });
+            sink += kept;
+            string label = string(load.label) + (lazy ? ", lazy" : "") + ", " + std::to_string(kept) + " kept";
+            results.push_back(std::make_pair(label, seconds));
+        }
+    }
+    std::cout.rdbuf(shown);
+    std::remove(path);
+
+    for (const auto& result : results) {
+        report(result.first, result.second * 1e3, "ms");
+    }
+}
+
+/**
+ * Simple C function to convert a string to a double
+ * after stripping out unwanted char
+ *
+ * The amount parser before strToCents, kept here to time against it
+ *
+ * credit: http://stackoverflow.com/a/24875936
+ *
+ * @param ch The character to strip out
+ * @param str The string to convert
+ */
+static double strToDouble(string str, char ch) {
+    str.erase(remove(str.begin(), str.end(), ch), str.end());
+    return atof(str.c_str());
+}
+
+/**
+ * strToCents on amounts as the exports write them, against stripping
+ * the dollar sign from a copy and calling atof the way loading did
+ * before amounts were cents
+ */
+static void benchAmountParsing() {
+    const int count = 1000000;
+
+    std::mt19937 random(10);
+    vector<string> amounts;
+    for (int i = 0; i < count; i++) {
+        unsigned int dollars = random() % 20000;
+        unsigned int cents = random() % 100;
+        char text[32];
+        if (dollars >= 1000) {
+            std::snprintf(text, sizeof(text), "$%u,%03u.%02u", dollars / 1000, dollars % 1000, cents);
+        }
+        else {
+            std::snprintf(text, sizeof(text), "$%u.%02u", dollars, cents);
+        }
+        amounts.push_back(text);
+    }
+
+    int64_t total = 0;
+    double parsed = bestOf(3, [&]() {
+        for (const string& amount : amounts) {
+            total += strToCents(amount).value;
+        }
+    });
+    sink += (size_t)total;
+
+    double converted = 0;
+    double copied = bestOf(3, [&]() {
+        for (const string& amount : amounts) {
+            //as loading called it, which reads "$1,234.56" as 1
+            converted += strToDouble(amount, '$');
+        }
+    });
+    sink += (size_t)converted;
+
+    report("strToCents", parsed * 1e9 / count, "ns");
+    report("strToDouble", copied * 1e9 / count, "ns");
+}
+
+//============================================================================
+// Benchmark runner
+//============================================================================
+
+/**
+ * Run every benchmark, or only those named on the command line
+ */
+int main(int argc, char* argv[]) {
+    const struct {
+        const char* name;
+        void (*run)();
+    } benches[] = {
+        { "sorted and shuffled load", benchSortedAndShuffledLoad },
+        { "amount ranges", benchAmountRanges },
+        { "tokenizer", benchTokenizer },
+        { "backends", benchBackends },
+        { "id lookups", benchIdLookups },
+        { "parser load", benchParserLoad },
+        { "full dump", benchFullDump },
+        { "filtered load", benchFilteredLoad },
+        { "amount parsing", benchAmountParsing },
+    };
+
+    for (int arg = 1; arg < argc; arg++) {
+        bool known = false;
+        for (const auto& bench : benches) {
+            known = known || std::strcmp(argv[arg], bench.name) == 0;
+        }
+        if (!known) {
+            std::cerr << "unknown benchmark \"" << argv[arg] << "\", the benchmarks are:" << endl;
+            for (const auto& bench : benches) {
+                std::cerr << "  " << bench.name << endl;
+            }
+            return 1;
+        }
+    }
+
+    for (const auto& bench : benches) {
+        bool wanted = (argc == 1);
+        for (int arg = 1; arg < argc; arg++) {
+            wanted = wanted || std::strcmp(argv[arg], bench.name) == 0;
+        }
+        if (wanted) {
+            std::cout << bench.name << endl;
+            bench.run();
+        }
+    }
+    return 0;
+}
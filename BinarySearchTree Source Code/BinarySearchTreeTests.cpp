@@ -0,0 +1,1127 @@
+//============================================================================
+// Name        : BinarySearchTreeTests.cpp
+// Author      : John Austin
+// Version     : 1.0
+// Copyright   : Copyright © 2017 SNHU COCE
+// Description : Regression tests for the bid tree and the CSV readers
+//============================================================================
+
+// the tree is built into this program, without its menu
+#define BINARYSEARCHTREE_NO_MAIN
+#include "JohnAustinBinarySearchTree.cpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+
+//============================================================================
+// Checks
+//============================================================================
+
+// failed checks so far, the exit status is nonzero if there are any
+static int failures = 0;
+
+/**
+ * Report a check that does not hold
+ *
+ * @param holds Result of the check
+ * @param text The check as written
+ * @param line Where it is written
+ */
+static void check(bool holds, const char* text, int line) {
+    if (!holds) {
+        failures++;
+        std::cerr << "  line " << line << ": " << text << " does not hold" << endl;
+    }
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+/**
+ * A bid with a numeric id and the given winning amount in cents
+ *
+ * @param id Auction id
+ * @param cents Winning amount
+ */
+static Bid makeBid(unsigned int id, int64_t cents) {
+    Bid bid;
+    bid.bidId = std::to_string(id);
+    bid.title = "Item " + bid.bidId;
+    bid.amount = Cents(cents);
+    return bid;
+}
+
+/**
+ * Write a file for a reader test, replacing any earlier one
+ *
+ * @param path Where to write it
+ * @param text Whole contents, written as is
+ */
+static void writeFile(const string& path, const string& text) {
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(text.data(), text.size());
+}
+
+// bids in amount order, walked the way Display All walks id order
+static unsigned int countByAmount(BinarySearchTree& bst) {
+    unsigned int count = 0;
+    bst.InAmountOrder([&count](const Bid&) { count++; });
+    return count;
+}
+
+//============================================================================
+// Tests
+//============================================================================
+
+/**
+ * A million ids inserted in ascending order, the input that made the
+ * recursive trees as deep as they were long
+ */
+static void testMillionSortedIds() {
+    const unsigned int count = 1000000;
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        for (unsigned int id = 1; id <= count; id++) {
+            bst.Insert(makeBid(id, id % 5000));
+        }
+        CHECK(bst.Size() == count);
+
+        //every id comes back once, in order
+        unsigned int walked = 0;
+        bool ordered = true;
+        bst.InBidOrder([&walked, &ordered](const Bid& bid) {
+            walked++;
+            ordered = ordered && bid.bidId == std::to_string(walked);
+        });
+        CHECK(walked == count);
+        CHECK(ordered);
+        CHECK(countByAmount(bst) == count);
+        CHECK(bst.BidSearch("1").bidId == "1");
+        CHECK(bst.BidSearch("1000000").bidId == "1000000");
+        CHECK(bst.BidSearch("1000001").bidId.empty());
+
+        //teardown walks the tree too
+        bst.Clear();
+        CHECK(bst.Size() == 0);
+    }
+}
+
+/**
+ * Bids removed and inserted again round after round must leave both
+ * indexes agreeing on what is there, and reuse the same memory
+ */
+static void testInsertRemoveChurn() {
+    const unsigned int count = 20000;
+    const unsigned int batch = 2000;
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        vector<unsigned int> ids;
+        int64_t total = 0;
+        for (unsigned int id = 1; id <= count; id++) {
+            //many bids share an amount, so equal keys are removed too
+            bst.Insert(makeBid(id, id % 997 * 100));
+            ids.push_back(id);
+            total += id % 997 * 100;
+        }
+        size_t capacity = bst.Capacity();
+
+        std::mt19937 random(9);
+        for (int round = 0; round < 50; round++) {
+            //the menu freezes after a load, removals must thaw first
+            if (round % 10 == 0) {
+                bst.Freeze();
+            }
+
+            std::shuffle(ids.begin(), ids.end(), random);
+            int64_t removedTotal = 0;
+            for (unsigned int i = 0; i < batch; i++) {
+                CHECK(bst.Remove(std::to_string(ids[i])));
+                removedTotal += ids[i] % 997 * 100;
+            }
+            CHECK(!bst.Remove(std::to_string(ids[0])));
+
+            //the removed bids are gone from both orders
+            unsigned int left = count - batch;
+            unsigned int inRange = 0;
+            bst.AmountSearch(Cents(INT64_MIN), Cents(INT64_MAX), [&inRange](const Bid&) { inRange++; });
+            CHECK(bst.Size() == left);
+            CHECK(countByAmount(bst) == left);
+            CHECK(inRange == left);
+            CHECK(bst.CountInRange(Cents(INT64_MIN), Cents(INT64_MAX)) == left);
+            CHECK(bst.TotalsInRange(Cents(INT64_MIN), Cents(INT64_MAX)).total.value == total - removedTotal);
+            bool gone = true;
+            for (unsigned int i = 0; i < batch; i++) {
+                gone = gone && bst.BidSearch(std::to_string(ids[i])).bidId.empty();
+            }
+            CHECK(gone);
+
+            for (unsigned int i = 0; i < batch; i++) {
+                bst.Insert(makeBid(ids[i], ids[i] % 997 * 100));
+            }
+            CHECK(bst.Size() == count);
+            CHECK(countByAmount(bst) == count);
+            CHECK(bst.TotalsInRange(Cents(INT64_MIN), Cents(INT64_MAX)).total.value == total);
+
+            //released nodes are reused, so the pool never grows
+            CHECK(bst.Capacity() == capacity);
+        }
+    }
+}
+
+/**
+ * Amounts as the exports and the menu write them parse into cents,
+ * and print back the way a double amount used to print
+ */
+static void testAmountsInCents() {
+    //dollar signs, thousands separators, quotes and blanks are skipped
+    CHECK(strToCents("$225.46").value == 22546);
+    CHECK(strToCents("$1,234.56").value == 123456);
+    CHECK(strToCents("$1,234,567").value == 123456700);
+    CHECK(strToCents("\"$1,234.56\"").value == 123456);
+    CHECK(strToCents(" 12.5\t").value == 1250);
+
+    //a leading minus, before or after the dollar sign
+    CHECK(strToCents("-12.5").value == -1250);
+    CHECK(strToCents("-$1,000.01").value == -100001);
+    CHECK(strToCents("$-3").value == -300);
+
+    //one, two and more decimals, the third rounding half up
+    CHECK(strToCents("12").value == 1200);
+    CHECK(strToCents("12.").value == 1200);
+    CHECK(strToCents(".5").value == 50);
+    CHECK(strToCents("12.3").value == 1230);
+    CHECK(strToCents("12.34").value == 1234);
+    CHECK(strToCents("12.344").value == 1234);
+    CHECK(strToCents("12.345").value == 1235);
+    CHECK(strToCents("12.3449").value == 1234);
+    CHECK(strToCents("0.995").value == 100);
+    CHECK(strToCents("-0.995").value == -100);
+
+    //like atof, the parse stops at anything else
+    CHECK(strToCents("").value == 0);
+    CHECK(strToCents("abc").value == 0);
+    CHECK(strToCents("12abc").value == 1200);
+    CHECK(strToCents("1.2.3").value == 120);
+    CHECK(strToCents("1-2").value == 100);
+
+    //amounts saturate at INT64_MAX / 1000 dollars instead of overflowing
+    const int64_t maxWhole = INT64_MAX / 1000;
+    CHECK(strToCents("9223372036854775.99").value == maxWhole * 100 + 99);
+    CHECK(strToCents("9223372036854776").value == maxWhole * 100);
+    CHECK(strToCents("99999999999999999999999999.99").value == maxWhole * 100);
+    CHECK(strToCents("-99999999999999999999999999").value == -maxWhole * 100);
+    CHECK(strToCents("$99,999,999,999,999,999,999,999").value == maxWhole * 100);
+
+    auto print = [](int64_t cents) {
+        char text[24];
+        return string(text, centsToChars(text, text + sizeof(text), Cents(cents)));
+    };
+    CHECK(print(22546) == "225.46");
+    CHECK(print(1250) == "12.5");
+    CHECK(print(10000) == "100");
+    CHECK(print(5) == "0.05");
+    CHECK(print(0) == "0");
+    CHECK(print(-1250) == "-12.5");
+    CHECK(print(-5) == "-0.05");
+    CHECK(print(INT64_MAX) == "92233720368547758.07");
+    CHECK(print(INT64_MIN) == "-92233720368547758.08");
+
+    //what centsToChars prints reads back as the same amount
+    bool roundTrip = true;
+    for (int64_t cents : { (int64_t)0, (int64_t)7, (int64_t)-7, (int64_t)1250, (int64_t)-123456, maxWhole * 100 + 99 }) {
+        roundTrip = roundTrip && strToCents(print(cents)).value == cents;
+    }
+    CHECK(roundTrip);
+}
+
+/**
+ * Bid ids order as IdKey compares them: ids of up to 19 digits without
+ * a leading zero are numbers and order by value, then every other id
+ * orders as text, after all the numbers. The expected order is:
+ *
+ *   0 < 7 < 99999 < 100000 < 9999999999999999999
+ *     < "" < "00" < "007" < "10000000000000000000" < "7A" < "A7" < "a"
+ */
+static void testIdKeyOrder() {
+    const string ordered[] = {
+        "0", "7", "99999", "100000", "9999999999999999999",
+        "", "00", "007", "10000000000000000000", "7A", "A7", "a",
+    };
+    const size_t count = sizeof(ordered) / sizeof(ordered[0]);
+
+    //numbers compare by value, not as text
+    CHECK(IdKey("99999") < IdKey("100000"));
+    CHECK(!(IdKey("100000") < IdKey("99999")));
+    CHECK(IdKey("99999").text == nullptr);
+    CHECK(IdKey("100000").number == 100000);
+
+    //a leading zero or a twentieth digit keeps an id text
+    CHECK(IdKey("007").text != nullptr);
+    CHECK(IdKey("007").compare(IdKey("7")) > 0);
+    CHECK(IdKey("0").text == nullptr);
+    CHECK(IdKey("10000000000000000000").text != nullptr);
+
+    //a text id keeps its length, whatever digits come before the letter
+    CHECK(IdKey("12A").number == 3);
+    CHECK(IdKey("12345678901234567A").number == 18);
+
+    bool pairwise = true;
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < count; j++) {
+            int expected = (i > j) - (i < j);
+            int compared = IdKey(ordered[i]).compare(IdKey(ordered[j]));
+            pairwise = pairwise && ((compared > 0) - (compared < 0)) == expected;
+        }
+    }
+    CHECK(pairwise);
+
+    //both backends walk the ids in the same order
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        for (size_t i = count; i-- > 0;) {
+            Bid bid = makeBid(0, 100);
+            bid.bidId = ordered[i];
+            bst.Insert(bid);
+        }
+        vector<string> walked;
+        bst.InBidOrder([&walked](const Bid& bid) { walked.push_back(bid.bidId); });
+        CHECK(walked == vector<string>(ordered, ordered + count));
+    }
+}
+
+/**
+ * Frozen searches keep numeric and text ids in separate arrays, and
+ * must still find the same bid as the live indexes for every id, and
+ * the same next bid for ids that are not there
+ */
+static void testFrozenLookupsMatchLive() {
+    std::mt19937 random(12);
+    vector<string> ids;
+    for (int i = 0; i < 3000; i++) {
+        ids.push_back(std::to_string(random() % 100000));
+    }
+    for (int i = 0; i < 300; i++) {
+        ids.push_back("A" + std::to_string(random() % 100000));
+    }
+    //leading zeros keep an id text
+    ids.push_back("007");
+    ids.push_back("0");
+
+    vector<string> probes(ids);
+    for (int i = 0; i < 3000; i++) {
+        probes.push_back(std::to_string(random() % 110000));
+        probes.push_back("A" + std::to_string(random() % 110000));
+    }
+    probes.push_back("18446744073709551615");
+    probes.push_back("");
+    probes.push_back("~");
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        for (bool withText : { true, false }) {
+            BinarySearchTree bst(backend);
+            for (const string& id : ids) {
+                if (withText || id[0] != 'A') {
+                    Bid bid = makeBid(0, 100);
+                    bid.bidId = id;
+                    bst.Insert(bid);
+                }
+            }
+
+            vector<string> live;
+            for (const string& probe : probes) {
+                auto it = bst.BidLowerBound(probe);
+                live.push_back((it == bst.BidEnd()) ? "end" : it->bidId);
+            }
+
+            bst.Freeze();
+            bool same = true;
+            for (size_t i = 0; i < probes.size(); i++) {
+                auto it = bst.BidLowerBound(probes[i]);
+                same = same && live[i] == ((it == bst.BidEnd()) ? "end" : it->bidId);
+            }
+            CHECK(same);
+            bool found = true;
+            for (const string& id : ids) {
+                found = found && (bst.BidSearch(id).bidId == id || (!withText && id[0] == 'A'));
+            }
+            CHECK(found);
+        }
+    }
+}
+
+/**
+ * Conditions parse into a column, an operator and a value, compare as
+ * amounts when the value reads as money and as trimmed text otherwise,
+ * and a filtered load keeps exactly the rows meeting all of them
+ */
+static void testLoadConditions() {
+    BidCondition condition;
+
+    //every operator, two character ones not taken for one character ones
+    const struct {
+        const char* text;
+        ConditionOp op;
+    } ops[] = {
+        { "WinningBid == 5", OP_EQUAL }, { "WinningBid != 5", OP_NOT_EQUAL },
+        { "WinningBid < 5", OP_LESS }, { "WinningBid <= 5", OP_LESS_EQUAL },
+        { "WinningBid > 5", OP_GREATER }, { "WinningBid >= 5", OP_GREATER_EQUAL },
+    };
+    bool parsed = true;
+    for (const auto& op : ops) {
+        parsed = parsed && parseCondition(op.text, condition) && condition.op == op.op
+            && condition.column == "WinningBid" && condition.text == "5";
+    }
+    CHECK(parsed);
+
+    //money values are amounts, anything else is text
+    CHECK(parseCondition("Winning Bid>=$1,000.50", condition));
+    CHECK(condition.column == "Winning Bid");
+    CHECK(condition.isAmount);
+    CHECK(condition.amount.value == 100050);
+    CHECK(parseCondition(" Fund == \"General Fund\" ", condition));
+    CHECK(condition.column == "Fund");
+    CHECK(condition.text == "General Fund");
+    CHECK(!condition.isAmount);
+    CHECK(parseCondition("ArticleTitle < 5 Rims", condition));
+    CHECK(!condition.isAmount);
+    CHECK(parseCondition("ArticleID <= 150", condition));
+    CHECK(condition.isAmount);
+
+    //malformed conditions
+    CHECK(!parseCondition("Fund = General", condition));
+    CHECK(!parseCondition("Fund ! General", condition));
+    CHECK(!parseCondition("Fund => General", condition));
+    CHECK(!parseCondition("Fund General", condition));
+    CHECK(!parseCondition("== 5", condition));
+    CHECK(!parseCondition("WinningBid >=", condition));
+    CHECK(!parseCondition("WinningBid >= \"\"", condition));
+    CHECK(!parseCondition("", condition));
+
+    //amount columns compare by value, whatever the field looks like
+    parseCondition("WinningBid < 100", condition);
+    CHECK(conditionHolds(condition, "$99.99"));
+    CHECK(conditionHolds(condition, "\"$99.99\""));
+    CHECK(!conditionHolds(condition, "$100"));
+    CHECK(!conditionHolds(condition, "$1,000"));
+    parseCondition("WinningBid == 1000", condition);
+    CHECK(conditionHolds(condition, "$1,000.00"));
+    parseCondition("WinningBid != 1000", condition);
+    CHECK(!conditionHolds(condition, "1000.001"));
+    CHECK(conditionHolds(condition, "1000.01"));
+    parseCondition("WinningBid <= 10", condition);
+    CHECK(conditionHolds(condition, "10"));
+    CHECK(conditionHolds(condition, "-20"));
+    CHECK(!conditionHolds(condition, "10.01"));
+    parseCondition("WinningBid > 10", condition);
+    CHECK(!conditionHolds(condition, "10"));
+    CHECK(conditionHolds(condition, "10.01"));
+    parseCondition("WinningBid >= 10", condition);
+    CHECK(conditionHolds(condition, "10"));
+    CHECK(!conditionHolds(condition, "9.994"));
+
+    //text columns compare the trimmed text, so "Item 100" orders first
+    parseCondition("Fund == General Fund", condition);
+    CHECK(conditionHolds(condition, " \"General Fund\" "));
+    CHECK(!conditionHolds(condition, "General"));
+    parseCondition("ArticleTitle < Item 99", condition);
+    CHECK(conditionHolds(condition, "Item 100"));
+    CHECK(!conditionHolds(condition, "Item 990"));
+    parseCondition("Fund >= M", condition);
+    CHECK(conditionHolds(condition, "M"));
+    CHECK(!conditionHolds(condition, "Enterprise"));
+
+    //a load filtered by several conditions against the rows written
+    const string path = "load_conditions.csv";
+    const char* funds[] = { "General Fund", "Enterprise", "\"Capital, Reserve\"" };
+    string text = "ArticleTitle,ArticleID,Fund,WinningBid\n";
+    vector<string> filtered;
+    for (unsigned int id = 1; id <= 600; id++) {
+        unsigned int cents = id * 7919 % 200000;
+        char amount[32];
+        std::snprintf(amount, sizeof(amount), "\"$%u,%03u.%02u\"", cents / 100000, cents / 100 % 1000, cents % 100);
+        text += "Item " + std::to_string(id) + "," + std::to_string(id) + "," + funds[id % 3] + "," + amount + "\n";
+        if (id % 3 != 2 && cents >= 50000 && cents < 150000 && id <= 500) {
+            filtered.push_back(std::to_string(id));
+        }
+    }
+    writeFile(path, text);
+
+    vector<BidCondition> conditions;
+    for (const char* written : { "WinningBid >= $500", "WinningBid < 1,500", "Fund != Capital, Reserve", "ArticleID <= 500" }) {
+        conditions.push_back(BidCondition());
+        CHECK(parseCondition(written, conditions.back()));
+    }
+    vector<BidCondition> unknown(1);
+    CHECK(parseCondition("Department == POLICE", unknown[0]));
+
+    //the loads print the header and the unknown column, which is not checked
+    auto load = [&path](BinarySearchTree& bst, const vector<BidCondition>& conditions, bool lazy) {
+        std::streambuf* shown = std::cout.rdbuf(nullptr);
+        std::streambuf* errors = std::cerr.rdbuf(nullptr);
+        loadBids(path, &bst, conditions, lazy);
+        std::cout.rdbuf(shown);
+        std::cerr.rdbuf(errors);
+    };
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        for (bool lazy : { false, true }) {
+            BinarySearchTree bst(backend);
+            load(bst, conditions, lazy);
+            vector<string> loaded;
+            bst.InBidOrder([&loaded](const Bid& bid) { loaded.push_back(bid.bidId); });
+            CHECK(loaded == filtered);
+            CHECK(countByAmount(bst) == filtered.size());
+
+            //a column the file does not have loads nothing
+            BinarySearchTree none(backend);
+            load(none, unknown, lazy);
+            CHECK(none.Size() == 0);
+        }
+
+        //loading into a tree that already holds bids inserts each one
+        BinarySearchTree bst(backend);
+        bst.Insert(makeBid(1000, 1));
+        load(bst, conditions, false);
+        CHECK(bst.Size() == filtered.size() + 1);
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * A last record without a newline must come back whole, whether it
+ * fits the first read window, is cut in two by the end of it, or only
+ * comes in with a refill after other records
+ */
+static void testReaderLastRecordWithoutNewline() {
+    const string path = "reader_last_record.csv";
+    const string last = "98083,Horse Trailer";
+
+    //a parallel reader has a window of 1 MiB per thread
+    for (unsigned int threads : { 1, 4 }) {
+        const size_t window = (size_t)threads << 20;
+
+        //where the last record starts: right after the header, cut after
+        //each of its characters in turn, and well into the second window
+        vector<size_t> starts = { 5 };
+        for (size_t cut = 1; cut < last.size(); cut++) {
+            starts.push_back(window - cut);
+        }
+        starts.push_back(window + 100);
+
+        for (size_t start : starts) {
+            const string row = "1,filler\n";
+            string text = "id,t\n";
+            size_t rows = 0;
+            while (text.size() + row.size() <= start) {
+                text += row;
+                rows++;
+            }
+            text.append(start - text.size(), '\n'); // blank lines are skipped
+            text += last;
+            writeFile(path, text);
+
+            csv::Reader reader(path, ',', threads);
+            vector<string_view> fields;
+            size_t read = 0;
+            bool whole = false;
+            while (reader.next(fields)) {
+                read++;
+                whole = fields.size() == 2 && fields[0] == "98083" && fields[1] == "Horse Trailer"
+                    && reader.offsetOf(fields[0]) == start;
+            }
+            CHECK(read == rows + 1);
+            CHECK(whole);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * A parallel reader must hand out exactly the records, fields and
+ * offsets of a serial one, with quoted separators, quotes and newlines
+ * falling anywhere around the cuts between chunks and windows
+ */
+static void testParallelReaderMatchesSerial() {
+    const string path = "reader_parallel.csv";
+    std::mt19937 random(5);
+
+    for (int file = 0; file < 4; file++) {
+        //about 9 MiB, so every thread count sees several windows
+        string text = "id,title,amount\n";
+        for (unsigned int id = 0; text.size() < (9u << 20); id++) {
+            text += std::to_string(id);
+            text += ',';
+            switch (random() % 6) {
+            case 0:
+                text += "\"line one\nline two, with a comma\"";
+                break;
+            case 1:
+                text += "\"say \"\"hi\"\"\"";
+                break;
+            case 2:
+                text += "\"\n\n\"";
+                break;
+            default:
+                text.append(random() % 40, 'a' + (char)(id % 26));
+                break;
+            }
+            text += ",$";
+            text += std::to_string(random() % 100000);
+            text += (random() % 50 == 0) ? "\n\n" : "\n";
+        }
+        //the last file ends without a newline
+        if (file == 3) {
+            text.pop_back();
+        }
+        writeFile(path, text);
+
+        vector<vector<string>> serial;
+        vector<uint64_t> serialOffsets;
+        csv::Reader reader(path);
+        vector<string_view> fields;
+        while (reader.next(fields)) {
+            serial.emplace_back(fields.begin(), fields.end());
+            serialOffsets.push_back(reader.offsetOf(fields.back()));
+        }
+        CHECK(serial.size() > 100000);
+
+        for (unsigned int threads : { 2, 3, 4, 7 }) {
+            csv::Reader parallel(path, ',', threads);
+            size_t read = 0;
+            bool same = true;
+            while (parallel.next(fields)) {
+                same = same && read < serial.size()
+                    && vector<string>(fields.begin(), fields.end()) == serial[read]
+                    && parallel.offsetOf(fields.back()) == serialOffsets[read];
+                read++;
+            }
+            CHECK(read == serial.size());
+            CHECK(same);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * A parallel MappedParser must give exactly the rows of a serial one,
+ * with most of the file inside quoted fields spanning several lines so
+ * the even cuts between chunks land inside them
+ */
+static void testParallelMappedParserMatchesSerial() {
+    const string path = "mapped_parallel.csv";
+    std::mt19937 random(6);
+
+    for (int file = 0; file < 2; file++) {
+        //about 9 MiB, so up to 9 chunks of the 1 MiB minimum
+        const string header = "id,notes,amount\n";
+        string text = header;
+        for (unsigned int id = 0; text.size() < (9u << 20); id++) {
+            text += std::to_string(id);
+            text += ",\"";
+            for (int line = random() % 12 + 1; line > 0; line--) {
+                text.append(random() % 30, 'a' + (char)(id % 26));
+                text += (random() % 3 == 0) ? ", \"\"quoted\"\"\n" : "\n";
+            }
+            text += "\",$";
+            text += std::to_string(random() % 100000);
+            text += '\n';
+        }
+        if (file == 1) {
+            text.pop_back();
+        }
+        writeFile(path, text);
+
+        //where each thread count cuts the body, and how many of those
+        //cuts fall inside a quoted field
+        size_t body = text.size() - header.size();
+        vector<size_t> cuts;
+        for (unsigned int threads : { 2, 3, 4, 7 }) {
+            for (unsigned int c = 1; c < threads; c++) {
+                cuts.push_back(header.size() + body * c / threads);
+            }
+        }
+        std::sort(cuts.begin(), cuts.end());
+        unsigned int quotedCuts = 0;
+        bool quoted = false;
+        size_t next = 0;
+        for (size_t at = 0; at < text.size() && next < cuts.size(); at++) {
+            while (next < cuts.size() && cuts[next] == at) {
+                quotedCuts += quoted;
+                next++;
+            }
+            quoted = quoted != (text[at] == '"');
+        }
+        CHECK(quotedCuts >= cuts.size() / 2);
+
+        csv::MappedParser serial(path);
+        CHECK(serial.rowCount() > 50000);
+        CHECK(serial.getRow(serial.rowCount() - 1)[0] == std::to_string(serial.rowCount() - 1));
+
+        for (unsigned int threads : { 2, 3, 4, 7 }) {
+            //a chunk cut inside a record shows up as a corrupted data error
+            bool same = false;
+            try {
+                csv::MappedParser parallel(path, ',', threads);
+                same = parallel.rowCount() == serial.rowCount();
+                for (unsigned int row = 0; same && row < serial.rowCount(); row++) {
+                    for (unsigned int column = 0; column < serial.columnCount(); column++) {
+                        same = same && parallel.getRow(row)[column] == serial.getRow(row)[column];
+                    }
+                }
+            }
+            catch (const csv::Error&) {
+            }
+            CHECK(same);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+/**
+ * A bulk load links every bid its reader hands over, also when the
+ * reader stops with an error part way
+ */
+static void testBulkLoadKeepsBidsBeforeError() {
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        unsigned int next = 0;
+        bool thrown = false;
+        try {
+            bst.BulkLoad([&next](Bid& bid) {
+                if (next == 1000) {
+                    throw csv::Error("corrupted data !");
+                }
+                next++;
+                bid = makeBid(1000 - next, next % 10);
+                return true;
+            });
+        }
+        catch (csv::Error&) {
+            thrown = true;
+        }
+        CHECK(thrown);
+        CHECK(bst.Size() == 1000);
+        CHECK(countByAmount(bst) == 1000);
+        CHECK(bst.BidSearch("0").bidId == "0");
+        CHECK(bst.BidSearch("999").bidId == "999");
+    }
+}
+
+/**
+ * Text ids are compared through pointers into the pooled bids, so an
+ * index must not keep a removed id anywhere once its bid is released:
+ * the next bid reuses the slot and would change the id under it
+ */
+static void testRemovedIdNotKeptAsSeparator() {
+    const unsigned int count = 300;
+    char id[8];
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        //text ids in ascending order, so the B+ leaves fill and split
+        //and their first ids become separators in the inner nodes
+        BinarySearchTree bst(backend);
+        vector<string> present;
+        for (unsigned int i = 0; i < count; i++) {
+            std::snprintf(id, sizeof(id), "t%03u", i);
+            Bid bid = makeBid(0, i);
+            bid.bidId = id;
+            bst.Insert(bid);
+            present.push_back(id);
+        }
+
+        //each removal frees a slot that the next insert takes over with
+        //an id sorting elsewhere, then every id left must still be found
+        bool found = true;
+        for (unsigned int i = 0; i < count; i += 3) {
+            CHECK(bst.Remove(present[i]));
+            std::snprintf(id, sizeof(id), "u%03u", i);
+            Bid bid = makeBid(0, i);
+            bid.bidId = id;
+            bst.Insert(bid);
+            present[i] = id;
+
+            for (const string& kept : present) {
+                found = found && bst.BidSearch(kept).bidId == kept;
+            }
+        }
+        CHECK(found);
+        CHECK(bst.Size() == count);
+    }
+}
+
+/**
+ * A page after removals of bids already handed out starts right after
+ * the last one, even when it was removed and a bid with its amount
+ * took over its memory
+ */
+static void testCursorResumesAfterRemovals() {
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        for (unsigned int id = 1; id <= 4; id++) {
+            bst.Insert(makeBid(id, 10000));
+        }
+        bst.Insert(makeBid(5, 20000));
+
+        vector<string> page;
+        BidVisitor collect = [&page](const Bid& bid) { page.push_back(bid.bidId); };
+        BinarySearchTree::AmountCursor cursor(bst);
+        CHECK(cursor.Next(2, collect) == 2);
+        CHECK(bst.Remove("1"));
+        CHECK(bst.Remove("2"));
+        page.clear();
+        cursor.Next(2, collect);
+        CHECK(page == vector<string>({ "3", "4" }));
+
+        //the new bid reuses the slot of the removed one
+        CHECK(bst.Remove("4"));
+        bst.Insert(makeBid(6, 10000));
+        page.clear();
+        cursor.Next(5, collect);
+        CHECK(page == vector<string>({ "6", "5" }));
+        CHECK(cursor.AtEnd());
+    }
+}
+
+/**
+ * Page through one order while bids are removed and inserted between
+ * pages, and compare every page with a model of the order
+ *
+ * Removals favor the last bid handed out, and removed ids come back,
+ * so equal keys keep landing right at the cursor
+ *
+ * @param backend Index structure to test
+ * @param byAmount Whether to walk the amount order rather than the ids
+ * @param seed Seed of the changes made
+ * @return whether every page matched
+ */
+template <typename Cursor>
+static bool pageThroughChurn(TreeBackend backend, bool byAmount, unsigned int seed) {
+    std::mt19937 random(seed);
+    BinarySearchTree bst(backend);
+
+    //key in the order walked, then insertion order, as the tree breaks
+    //ties, mapped to the bid id
+    typedef std::pair<int64_t, unsigned int> ModelKey;
+    std::map<ModelKey, unsigned int> model;
+    unsigned int inserted = 0;
+    unsigned int nextId = 1;
+    vector<unsigned int> removed;
+    auto insert = [&](unsigned int id) {
+        int64_t cents = random() % 5 * 100;
+        bst.Insert(makeBid(id, cents));
+        model[ModelKey(byAmount ? cents : (int64_t)id, inserted++)] = id;
+    };
+    for (int i = 0; i < 40; i++) {
+        insert(nextId++);
+    }
+
+    Cursor cursor(bst);
+    ModelKey last;
+    bool started = false;
+    for (;;) {
+        size_t count = 1 + random() % 4;
+        vector<unsigned int> page;
+        cursor.Next(count, [&page](const Bid& bid) { page.push_back((unsigned int)std::stoul(bid.bidId)); });
+
+        vector<unsigned int> expected;
+        auto next = started ? model.upper_bound(last) : model.begin();
+        for (; next != model.end() && expected.size() < count; ++next) {
+            expected.push_back(next->second);
+            last = next->first;
+            started = true;
+        }
+        if (page != expected) {
+            return false;
+        }
+        if (page.empty()) {
+            return cursor.AtEnd();
+        }
+
+        for (int changes = random() % 4; changes > 0 && !model.empty(); changes--) {
+            auto victim = model.find(last);
+            if (victim == model.end() || random() % 2 == 0) {
+                victim = std::next(model.begin(), random() % model.size());
+            }
+            bst.Remove(std::to_string(victim->second));
+            removed.push_back(victim->second);
+            model.erase(victim);
+        }
+        for (int changes = random() % 4; changes > 0; changes--) {
+            if (!removed.empty() && random() % 2 == 0) {
+                insert(removed.back());
+                removed.pop_back();
+            }
+            else {
+                insert(nextId++);
+            }
+        }
+    }
+}
+
+/**
+ * Cursors over both orders in both backends under churn
+ */
+static void testCursorUnderChurn() {
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        unsigned int passed = 0;
+        for (unsigned int seed = 0; seed < 200; seed++) {
+            passed += pageThroughChurn<BinarySearchTree::BidCursor>(backend, false, seed);
+            passed += pageThroughChurn<BinarySearchTree::AmountCursor>(backend, true, seed);
+        }
+        CHECK(passed == 400);
+    }
+}
+
+/**
+ * Rank, BidSelect, AmountSelect and CountInRange against sorted copies
+ * of the ids and amounts, with many bids sharing an amount, ranges that
+ * are empty or reach past either end, and after removals
+ */
+static void testRankAndSelectMatchModel() {
+    std::mt19937 random(24);
+    vector<string> ids;
+    for (unsigned int id = 0; id < 3000; id++) {
+        ids.push_back(std::to_string(10 + id * 3));
+    }
+    for (int i = 0; i < 100; i++) {
+        ids.push_back("X" + std::to_string(i));
+    }
+    std::shuffle(ids.begin(), ids.end(), random);
+    //40 amounts from -$10 to $87.50, each shared by about 80 bids
+    auto amountOf = [](const string& id) {
+        unsigned int mix = 0;
+        for (char c : id) {
+            mix = mix * 31 + (unsigned char)c;
+        }
+        return (int64_t)(mix % 40) * 250 - 1000;
+    };
+    auto idOrder = [](const string& a, const string& b) { return IdKey(a) < IdKey(b); };
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        for (const string& id : ids) {
+            Bid bid = makeBid(0, amountOf(id));
+            bid.bidId = id;
+            bst.Insert(bid);
+        }
+
+        //remove a third of the bids in a second pass, checking both times
+        for (int pass = 0; pass < 2; pass++) {
+            size_t kept = (pass == 0) ? ids.size() : ids.size() * 2 / 3;
+            vector<string> idModel(ids.begin(), ids.begin() + kept);
+            std::sort(idModel.begin(), idModel.end(), idOrder);
+            vector<int64_t> amountModel;
+            for (const string& id : idModel) {
+                amountModel.push_back(amountOf(id));
+            }
+            std::sort(amountModel.begin(), amountModel.end());
+            unsigned int size = (unsigned int)kept;
+            CHECK(bst.Size() == size);
+
+            bool selected = true;
+            for (unsigned int i = 0; i < size; i++) {
+                BinarySearchTree::BidIterator byId = bst.BidSelect(i);
+                BinarySearchTree::AmountIterator byAmount = bst.AmountSelect(i);
+                selected = selected && byId != bst.BidEnd() && byId->bidId == idModel[i]
+                    && bst.Rank(byId) == i && byAmount != bst.AmountEnd()
+                    && byAmount.Amount().value == amountModel[i] && bst.Rank(byAmount) == i;
+            }
+            CHECK(selected);
+            CHECK(bst.BidSelect(size) == bst.BidEnd());
+            CHECK(bst.AmountSelect(size) == bst.AmountEnd());
+            CHECK(bst.BidSelect(UINT_MAX) == bst.BidEnd());
+            CHECK(bst.Rank(bst.BidEnd()) == size);
+            CHECK(bst.Rank(bst.AmountEnd()) == size);
+
+            //the first of a run of equal amounts ranks where the run starts
+            bool ranked = true;
+            for (int64_t amount = -1250; amount <= 9000; amount += 125) {
+                size_t expected = std::lower_bound(amountModel.begin(), amountModel.end(), amount) - amountModel.begin();
+                ranked = ranked && bst.Rank(bst.AmountLowerBound(Cents(amount))) == expected;
+            }
+            CHECK(ranked);
+
+            //amount ranges, each end below, on, between or above the amounts
+            const int64_t ends[] = { INT64_MIN, -5000, -1000, -875, 0, 250, 4000, 8750, 8751, 20000, INT64_MAX };
+            bool counted = true;
+            for (int64_t low : ends) {
+                for (int64_t high : ends) {
+                    size_t expected = 0;
+                    if (low <= high) {
+                        expected = std::upper_bound(amountModel.begin(), amountModel.end(), high)
+                            - std::lower_bound(amountModel.begin(), amountModel.end(), low);
+                    }
+                    counted = counted && bst.CountInRange(Cents(low), Cents(high)) == expected;
+                }
+            }
+            CHECK(counted);
+
+            //id ranges, with ids that are there, between two, and past either end
+            const char* idEnds[] = { "0", "10", "11", "4000", "4001", "9007", "9008", "99999999", "X1", "X50", "Y" };
+            bool idsCounted = true;
+            for (const char* low : idEnds) {
+                for (const char* high : idEnds) {
+                    size_t expected = 0;
+                    if (!(IdKey(high) < IdKey(low))) {
+                        expected = std::upper_bound(idModel.begin(), idModel.end(), string(high), idOrder)
+                            - std::lower_bound(idModel.begin(), idModel.end(), string(low), idOrder);
+                    }
+                    idsCounted = idsCounted && bst.CountInRange(string(low), string(high)) == expected;
+                }
+            }
+            CHECK(idsCounted);
+
+            for (size_t i = ids.size() * 2 / 3; pass == 0 && i < ids.size(); i++) {
+                CHECK(bst.Remove(ids[i]));
+            }
+        }
+
+        //an empty tree has nothing to rank or select
+        bst.Clear();
+        CHECK(bst.BidSelect(0) == bst.BidEnd());
+        CHECK(bst.AmountSelect(0) == bst.AmountEnd());
+        CHECK(bst.Rank(bst.AmountEnd()) == 0);
+        CHECK(bst.CountInRange(Cents(INT64_MIN), Cents(INT64_MAX)) == 0);
+        CHECK(bst.CountInRange(string("0"), string("Z")) == 0);
+    }
+}
+
+/**
+ * TotalsInRange against sums over a copy of the bids, as bids holding
+ * the lowest or the highest amount are removed one after another, so
+ * the extremes every summary keeps have to move to the next bid
+ */
+static void testTotalsMatchModel() {
+    std::mt19937 random(25);
+    vector<std::pair<string, int64_t>> model;
+    for (unsigned int id = 1; id <= 400; id++) {
+        //amounts on both sides of zero, many of them shared
+        model.push_back(std::make_pair(std::to_string(id * 7), (int64_t)(random() % 301) * 37 - 5000));
+    }
+    std::shuffle(model.begin(), model.end(), random);
+
+    //what TotalsInRange should report for the bids the test selects
+    auto expect = [&model](std::function<bool(const std::pair<string, int64_t>&)> inRange) {
+        AmountTotals totals = AmountTotals();
+        for (const auto& bid : model) {
+            if (inRange(bid)) {
+                if (totals.count == 0 || bid.second < totals.lowest.value) {
+                    totals.lowest = Cents(bid.second);
+                }
+                if (totals.count == 0 || bid.second > totals.highest.value) {
+                    totals.highest = Cents(bid.second);
+                }
+                totals.count++;
+                totals.total.value += bid.second;
+            }
+        }
+        if (totals.count > 0) {
+            totals.average = Cents(std::llround((long double)totals.total.value / totals.count));
+        }
+        return totals;
+    };
+    auto same = [](const AmountTotals& a, const AmountTotals& b) {
+        return a.count == b.count && a.total == b.total && a.average == b.average
+            && a.lowest == b.lowest && a.highest == b.highest;
+    };
+
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        vector<std::pair<string, int64_t>> all(model);
+        BinarySearchTree bst(backend);
+        for (const auto& bid : model) {
+            Bid inserted = makeBid(0, bid.second);
+            inserted.bidId = bid.first;
+            bst.Insert(inserted);
+        }
+
+        const int64_t ends[] = { INT64_MIN, -6000, -5000, -2001, 0, 37, 3000, 6100, INT64_MAX };
+        const char* idEnds[] = { "0", "7", "700", "701", "1400", "2800", "9999" };
+        bool matched = true;
+        bool extremesRemoved = true;
+        for (int step = 0; !model.empty(); step++) {
+            for (int64_t low : ends) {
+                for (int64_t high : ends) {
+                    AmountTotals expected = expect([low, high](const std::pair<string, int64_t>& bid) {
+                        return bid.second >= low && bid.second <= high;
+                    });
+                    matched = matched && same(bst.TotalsInRange(Cents(low), Cents(high)), expected);
+                }
+            }
+            for (const char* low : idEnds) {
+                for (const char* high : idEnds) {
+                    AmountTotals expected = expect([low, high](const std::pair<string, int64_t>& bid) {
+                        return !(IdKey(bid.first) < IdKey(low)) && !(IdKey(high) < IdKey(bid.first));
+                    });
+                    matched = matched && same(bst.TotalsInRange(string(low), string(high)), expected);
+                }
+            }
+
+            //remove a bid with the lowest amount, then one with the highest
+            auto extreme = std::min_element(model.begin(), model.end(),
+                [step](const std::pair<string, int64_t>& a, const std::pair<string, int64_t>& b) {
+                    return (step % 2 == 0) ? a.second < b.second : a.second > b.second;
+                });
+            extremesRemoved = extremesRemoved && bst.Remove(extreme->first);
+            model.erase(extreme);
+        }
+        CHECK(matched);
+        CHECK(extremesRemoved);
+
+        //nothing is left in any range, and an empty range reports zeros
+        AmountTotals none = bst.TotalsInRange(Cents(INT64_MIN), Cents(INT64_MAX));
+        CHECK(none.count == 0 && none.total.value == 0 && none.average.value == 0);
+        CHECK(none.lowest.value == 0 && none.highest.value == 0);
+        model.swap(all);
+    }
+
+    //a range between two amounts, and a reversed one, with bids on both sides
+    for (TreeBackend backend : { RED_BLACK, B_PLUS }) {
+        BinarySearchTree bst(backend);
+        bst.Insert(makeBid(1, 100));
+        bst.Insert(makeBid(2, 300));
+        AmountTotals between = bst.TotalsInRange(Cents(101), Cents(299));
+        AmountTotals reversed = bst.TotalsInRange(Cents(300), Cents(100));
+        CHECK(between.count == 0 && between.lowest.value == 0 && between.highest.value == 0);
+        CHECK(reversed.count == 0 && reversed.total.value == 0 && reversed.average.value == 0);
+    }
+}
+
+//============================================================================
+// Test runner
+//============================================================================
+
+int main() {
+    const struct {
+        const char* name;
+        void (*run)();
+    } tests[] = {
+        { "million sorted ids", testMillionSortedIds },
+        { "insert and remove churn", testInsertRemoveChurn },
+        { "amounts in cents", testAmountsInCents },
+        { "id key order", testIdKeyOrder },
+        { "frozen lookups match live", testFrozenLookupsMatchLive },
+        { "bulk load keeps bids before an error", testBulkLoadKeepsBidsBeforeError },
+        { "load conditions", testLoadConditions },
+        { "reader last record without a newline", testReaderLastRecordWithoutNewline },
+        { "parallel reader matches serial", testParallelReaderMatchesSerial },
+        { "parallel mapped parser matches serial", testParallelMappedParserMatchesSerial },
+        { "removed id not kept as a separator", testRemovedIdNotKeptAsSeparator },
+        { "cursor resumes after removals", testCursorResumesAfterRemovals },
+        { "cursor under churn", testCursorUnderChurn },
+        { "rank and select match model", testRankAndSelectMatchModel },
+        { "totals match model", testTotalsMatchModel },
+    };
+
+    for (const auto& test : tests) {
+        int before = failures;
+        std::cout << test.name << endl;
+        test.run();
+        std::cout << ((failures == before) ? "  ok" : "  FAILED") << endl;
+    }
+
+    std::cout << failures << " failed checks" << endl;
+    return (failures == 0) ? 0 : 1;
+}
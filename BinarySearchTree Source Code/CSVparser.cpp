@@ -1,12 +1,200 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <sstream>
 #include <iomanip>
+#include <thread>
+#include <utility>
 #include "CSVparser.hpp"
 
+#ifdef _WIN32
+# define WIN32_LEAN_AND_MEAN
+# define NOMINMAX
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+# define CSV_SCAN_X86
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  define CSV_TARGET_AVX2
+# else
+#  define CSV_TARGET_AVX2 __attribute__((target("avx2")))
+# endif
+#endif
+
 namespace csv {
 
-  Parser::Parser(const std::string &data, const DataType &type, char sep)
-    : _type(type), _sep(sep)
+  /*
+  ** SCANNER
+  **
+  ** The tokenizer only stops on separators, quotes and newlines. Their
+  ** positions are found 64 bytes at a time as a bitmask, built with
+  ** SSE2 or AVX2 compares when the CPU has them (picked once at
+  ** startup), and the set bits are then walked one by one.
+  */
+
+  typedef uint64_t (*MaskFunction)(const char *, char);
+
+  // mask of the special bytes in the first size (at most 64) bytes of block
+  static uint64_t maskScalar(const char *block, size_t size, char sep)
+  {
+      uint64_t mask = 0;
+      for (size_t i = 0; i < size; i++)
+          if (block[i] == sep || block[i] == '"' || block[i] == '\n')
+              mask |= uint64_t(1) << i;
+      return mask;
+  }
+
+#ifndef CSV_SCAN_X86
+  static uint64_t maskBlockScalar(const char *block, char sep)
+  {
+      return maskScalar(block, 64, sep);
+  }
+#else
+  static uint64_t maskBlockSSE2(const char *block, char sep)
+  {
+      const __m128i seps = _mm_set1_epi8(sep);
+      const __m128i quotes = _mm_set1_epi8('"');
+      const __m128i newlines = _mm_set1_epi8('\n');
+      uint64_t mask = 0;
+
+      for (int i = 0; i < 64; i += 16)
+      {
+          __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+          __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, seps),
+                                                   _mm_cmpeq_epi8(bytes, quotes)),
+                                      _mm_cmpeq_epi8(bytes, newlines));
+          mask |= uint64_t(static_cast<unsigned int>(_mm_movemask_epi8(hits))) << i;
+      }
+      return mask;
+  }
+
+  CSV_TARGET_AVX2
+  static uint64_t maskBlockAVX2(const char *block, char sep)
+  {
+      const __m256i seps = _mm256_set1_epi8(sep);
+      const __m256i quotes = _mm256_set1_epi8('"');
+      const __m256i newlines = _mm256_set1_epi8('\n');
+      uint64_t mask = 0;
+
+      for (int i = 0; i < 64; i += 32)
+      {
+          __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+          __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, seps),
+                                                         _mm256_cmpeq_epi8(bytes, quotes)),
+                                         _mm256_cmpeq_epi8(bytes, newlines));
+          mask |= uint64_t(static_cast<unsigned int>(_mm256_movemask_epi8(hits))) << i;
+      }
+      return mask;
+  }
+
+  static bool hasAVX2(void)
+  {
+# ifdef _MSC_VER
+      int info[4];
+      __cpuid(info, 0);
+      if (info[0] < 7)
+          return false;
+
+      // the OS has to save the ymm registers too (OSXSAVE and XCR0 bits 1-2)
+      __cpuid(info, 1);
+      if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+          return false;
+
+      __cpuidex(info, 7, 0);
+      return (info[1] & (1 << 5)) != 0;
+# else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") != 0;
+# endif
+  }
+#endif
+
+  static MaskFunction selectMask(void)
+  {
+#ifdef CSV_SCAN_X86
+      if (hasAVX2())
+          return maskBlockAVX2;
+      return maskBlockSSE2;
+#else
+      return maskBlockScalar;
+#endif
+  }
+
+  static const MaskFunction maskBlock = selectMask();
+
+  static unsigned int lowestBit(uint64_t mask)
+  {
+#if defined(_MSC_VER) && defined(_WIN64)
+      unsigned long index;
+      _BitScanForward64(&index, mask);
+      return index;
+#elif defined(_MSC_VER)
+      unsigned long index;
+      if (_BitScanForward(&index, static_cast<unsigned long>(mask)))
+          return index;
+      _BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+      return index + 32;
+#else
+      return __builtin_ctzll(mask);
+#endif
+  }
+
+  // walks the special bytes of [begin, end) in order
+  class Scanner
+  {
+    public:
+      Scanner(const char *begin, const char *end, char sep)
+        : _begin(begin), _size(end - begin), _offset(0), _sep(sep)
+      {
+          _mask = load();
+      }
+
+      // position of the next special byte, or end
+      const char *next(void)
+      {
+          while (_mask == 0)
+          {
+              _offset += 64;
+              if (_offset >= _size)
+                  return _begin + _size;
+              _mask = load();
+          }
+          const char *pos = _begin + _offset + lowestBit(_mask);
+          _mask &= _mask - 1;
+          return pos;
+      }
+
+    private:
+      uint64_t load(void) const
+      {
+          if (_size - _offset >= 64)
+              return maskBlock(_begin + _offset, _sep);
+          return maskScalar(_begin + _offset, _size - _offset, _sep);
+      }
+
+      const char *_begin;
+      size_t _size;
+      size_t _offset;
+      const char _sep;
+      uint64_t _mask;
+  };
+
+  Parser::Parser(const std::string &data, const DataType &type, char sep,
+                 const Filter &filter)
+    : _type(type), _sep(sep), _filter(filter)
   {
       std::string line;
       if (type == eFILE)
@@ -66,6 +254,7 @@ namespace csv {
   void Parser::parseContent(void)
   {
      std::vector<std::string>::iterator it;
+     std::vector<std::string_view> fields;
      
      it = _originalFile.begin();
      it++; // skip header
@@ -73,28 +262,36 @@ namespace csv {
      for (; it != _originalFile.end(); it++)
      {
          bool quoted = false;
-         int tokenStart = 0;
-         unsigned int i = 0;
-
-         Row *row = new Row(_header);
+         const char *pos = it->data();
+         const char *end = pos + it->length();
+         const char *tokenStart = pos;
+         Scanner scanner(pos, end, ',');
 
-         for (; i != it->length(); i++)
+         // split into views first so filtered out records cost no strings
+         fields.clear();
+         while ((pos = scanner.next()) != end)
          {
-              if (it->at(i) == '"')
+              if (*pos == '"')
                   quoted = ((quoted) ? (false) : (true));
-              else if (it->at(i) == ',' && !quoted)
+              else if (*pos == ',' && !quoted)
               {
-                  row->push(it->substr(tokenStart, i - tokenStart));
-                  tokenStart = i + 1;
+                  fields.emplace_back(tokenStart, pos - tokenStart);
+                  tokenStart = pos + 1;
               }
          }
 
          //end
-         row->push(it->substr(tokenStart, it->length() - tokenStart));
+         fields.emplace_back(tokenStart, end - tokenStart);
 
          // if value(s) missing
-         if (row->size() != _header.size())
+         if (fields.size() != _header.size())
           throw Error("corrupted data !");
+         if (_filter && !_filter(fields))
+          continue;
+
+         Row *row = new Row(_header);
+         for (auto field = fields.begin(); field != fields.end(); field++)
+             row->push(std::string(*field));
          _content.push_back(row);
      }
   }
@@ -121,7 +318,7 @@ namespace csv {
       return _header.size();
   }
 
-  std::vector<std::string> Parser::getHeader(void) const
+  const std::vector<std::string> &Parser::getHeader(void) const
   {
       return _header;
   }
@@ -193,8 +390,12 @@ namespace csv {
   ** ROW
   */
 
+  // the header is referenced, not copied, so it must outlive the row
   Row::Row(const std::vector<std::string> &header)
-      : _header(header) {}
+      : _header(header)
+  {
+      _values.reserve(header.size());
+  }
 
   Row::~Row(void) {}
 
@@ -203,9 +404,14 @@ namespace csv {
     return _values.size();
   }
 
-  void Row::push(const std::string &value)
+  void Row::push(std::string value)
+  {
+    _values.push_back(std::move(value));
+  }
+
+  void Row::clear(void)
   {
-    _values.push_back(value);
+    _values.clear();
   }
 
   bool Row::set(const std::string &key, const std::string &value) 
@@ -225,14 +431,14 @@ namespace csv {
     return false;
   }
 
-  const std::string Row::operator[](unsigned int valuePosition) const
+  const std::string &Row::operator[](unsigned int valuePosition) const
   {
        if (valuePosition < _values.size())
            return _values[valuePosition];
        throw Error("can't return this value (doesn't exist)");
   }
 
-  const std::string Row::operator[](const std::string &key) const
+  const std::string &Row::operator[](const std::string &key) const
   {
       std::vector<std::string>::const_iterator it;
       int pos = 0;
@@ -265,4 +471,559 @@ namespace csv {
     }
     return os;
   }
+
+  /*
+  ** MAPPED FILE
+  */
+
+  MappedFile::MappedFile(const std::string &file)
+    : _data(nullptr), _size(0)
+  {
+#ifdef _WIN32
+      HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                                  NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+      if (handle == INVALID_HANDLE_VALUE)
+        throw Error(std::string("Failed to open ").append(file));
+
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0)
+      {
+        CloseHandle(handle);
+        throw Error(std::string("No Data in ").append(file));
+      }
+
+      HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+      CloseHandle(handle);
+      if (mapping == NULL)
+        throw Error(std::string("Failed to map ").append(file));
+
+      // the view keeps the mapping alive once both handles are closed
+      _data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+      CloseHandle(mapping);
+      if (_data == nullptr)
+        throw Error(std::string("Failed to map ").append(file));
+      _size = static_cast<size_t>(size.QuadPart);
+#else
+      int fd = open(file.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw Error(std::string("Failed to open ").append(file));
+
+      struct stat st;
+      if (fstat(fd, &st) != 0 || st.st_size == 0)
+      {
+        close(fd);
+        throw Error(std::string("No Data in ").append(file));
+      }
+
+      // the mapping stays valid once the descriptor is closed
+      void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (data == MAP_FAILED)
+        throw Error(std::string("Failed to map ").append(file));
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      _data = static_cast<const char *>(data);
+      _size = static_cast<size_t>(st.st_size);
+#endif
+  }
+
+  MappedFile::~MappedFile(void)
+  {
+#ifdef _WIN32
+      UnmapViewOfFile(_data);
+#else
+      munmap(const_cast<char *>(_data), _size);
+#endif
+  }
+
+  const char *MappedFile::data(void) const
+  {
+      return _data;
+  }
+
+  size_t MappedFile::size(void) const
+  {
+      return _size;
+  }
+
+  /*
+  ** MAPPED PARSER
+  */
+
+  // split one record starting at it into out, returns where it stopped:
+  // the unquoted newline ending the record, or end
+  static const char *parseRecord(const char *it, const char *end, char sep,
+                                 std::vector<std::string_view> &out)
+  {
+      bool quoted = false;
+      const char *tokenStart = it;
+
+      Scanner scanner(it, end, sep);
+
+      while ((it = scanner.next()) != end)
+      {
+          if (*it == '"')
+              quoted = !quoted;
+          else if (!quoted && *it == sep)
+          {
+              out.emplace_back(tokenStart, it - tokenStart);
+              tokenStart = it + 1;
+          }
+          else if (!quoted && *it == '\n')
+              break;
+      }
+
+      //end
+      out.emplace_back(tokenStart, it - tokenStart);
+      return it;
+  }
+
+  void splitRecord(std::string_view record, char sep, std::vector<std::string_view> &fields)
+  {
+      fields.clear();
+      parseRecord(record.data(), record.data() + record.size(), sep, fields);
+  }
+
+  // parse every record in [it, end) into out, checking the column count
+  static void parseRecords(const char *it, const char *end, char sep,
+                           size_t columns, std::vector<std::string_view> &out)
+  {
+      while (it != end)
+      {
+          // skip blank lines, the same as Parser
+          if (*it == '\n')
+          {
+              it++;
+              continue;
+          }
+
+          size_t first = out.size();
+          it = parseRecord(it, end, sep, out);
+
+          // if value(s) missing
+          if (out.size() - first != columns)
+            throw Error("corrupted data !");
+      }
+  }
+
+  MappedParser::MappedParser(const std::string &file, char sep, unsigned int threads)
+    : _file(file), _sep(sep),
+      _threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      _map(file)
+  {
+      parseContent();
+  }
+
+  MappedParser::~MappedParser(void) {}
+
+  void MappedParser::parseContent(void)
+  {
+      const char *it = _map.data();
+      const char *end = it + _map.size();
+
+      // skip blank lines, the same as Parser
+      while (it != end && *it == '\n')
+          it++;
+      if (it == end)
+        throw Error(std::string("No Data in ").append(_file));
+
+      it = parseRecord(it, end, _sep, _header);
+
+      if (_threads > 1)
+          parseChunks(it, end);
+      else
+          parseRecords(it, end, _sep, _header.size(), _fields);
+  }
+
+  // cut [begin, end), which starts at a record, into chunks that each
+  // start at a record too; chunks at the end may come out empty
+  static void cutChunks(const char *begin, const char *end, size_t chunks,
+                        std::vector<const char *> &cuts)
+  {
+      size_t size = end - begin;
+      cuts.resize(chunks + 1);
+      for (size_t c = 0; c <= chunks; c++)
+          cuts[c] = begin + size * c / chunks;
+
+      // count the quotes in each slice, the running parity tells whether
+      // a slice starts inside a quoted field
+      std::vector<std::future<size_t> > counts;
+      for (size_t c = 0; c < chunks; c++)
+      {
+          const char *from = cuts[c];
+          const char *to = cuts[c + 1];
+          counts.push_back(std::async(std::launch::async, [from, to]() {
+              return static_cast<size_t>(std::count(from, to, '"'));
+          }));
+      }
+
+      bool quoted = false;
+      for (size_t c = 1; c < chunks; c++)
+      {
+          quoted ^= (counts[c - 1].get() & 1) != 0;
+
+          // move the cut just past the first newline outside quotes
+          const char *it = cuts[c];
+          for (bool inside = quoted; it != end && (inside || *it != '\n'); it++)
+              if (*it == '"')
+                  inside = !inside;
+          cuts[c] = std::max(cuts[c - 1], (it == end) ? end : it + 1);
+      }
+  }
+
+  // split every record in [it, end) into fields, noting where each
+  // record's fields start; returns whether the last record ran into end
+  // without its newline
+  static bool parseRecordsAt(const char *it, const char *end, char sep,
+                             std::vector<std::string_view> &fields,
+                             std::vector<size_t> &starts)
+  {
+      bool open = false;
+      while (it != end)
+      {
+          // skip blank lines, the same as Parser
+          if (*it == '\n')
+          {
+              it++;
+              continue;
+          }
+
+          starts.push_back(fields.size());
+          it = parseRecord(it, end, sep, fields);
+          open = (it == end);
+          if (!open)
+              it++;
+      }
+      return open;
+  }
+
+  void MappedParser::parseChunks(const char *begin, const char *end)
+  {
+      // below about 1 MiB per chunk the threads cost more than they save
+      size_t size = end - begin;
+      size_t chunks = std::min<size_t>(_threads, size / (1 << 20) + 1);
+      if (chunks < 2)
+      {
+          parseRecords(begin, end, _sep, _header.size(), _fields);
+          return;
+      }
+
+      std::vector<const char *> cuts;
+      cutChunks(begin, end, chunks, cuts);
+
+      std::vector<std::vector<std::string_view> > parts(chunks);
+      std::vector<std::future<void> > workers;
+      for (size_t c = 0; c < chunks; c++)
+          workers.push_back(std::async(std::launch::async, [this, &cuts, &parts, c]() {
+              parseRecords(cuts[c], cuts[c + 1], _sep, _header.size(), parts[c]);
+          }));
+
+      // get() rethrows a corrupted data error from any chunk
+      size_t total = 0;
+      for (size_t c = 0; c < chunks; c++)
+      {
+          workers[c].get();
+          total += parts[c].size();
+      }
+
+      _fields.reserve(total);
+      for (size_t c = 0; c < chunks; c++)
+          _fields.insert(_fields.end(), parts[c].begin(), parts[c].end());
+  }
+
+  RowView MappedParser::getRow(unsigned int rowPosition) const
+  {
+      if (rowPosition < rowCount())
+          return RowView(&_fields[rowPosition * _header.size()], _header.size());
+      throw Error("can't return this row (doesn't exist)");
+  }
+
+  RowView MappedParser::operator[](unsigned int rowPosition) const
+  {
+      return MappedParser::getRow(rowPosition);
+  }
+
+  unsigned int MappedParser::rowCount(void) const
+  {
+      return _fields.size() / _header.size();
+  }
+
+  unsigned int MappedParser::columnCount(void) const
+  {
+      return _header.size();
+  }
+
+  const std::vector<std::string_view> &MappedParser::getHeader(void) const
+  {
+      return _header;
+  }
+
+  const std::string &MappedParser::getFileName(void) const
+  {
+      return _file;
+  }
+
+  /*
+  ** ROW VIEW
+  */
+
+  RowView::RowView(const std::string_view *values, unsigned int size)
+      : _values(values), _size(size) {}
+
+  unsigned int RowView::size(void) const
+  {
+    return _size;
+  }
+
+  std::string_view RowView::operator[](unsigned int valuePosition) const
+  {
+       if (valuePosition < _size)
+           return _values[valuePosition];
+       throw Error("can't return this value (doesn't exist)");
+  }
+
+  /*
+  ** READER
+  */
+
+  Reader::Reader(const std::string &file, char sep, unsigned int threads)
+    : _file(file), _sep(sep),
+      _threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      _stream(file.c_str(), std::ios::in | std::ios::binary),
+      _buffer(static_cast<size_t>(_threads) << 20), _offset(0), _begin(0), _end(0), _eof(false),
+      _chunk(0), _record(0)
+  {
+      if (!_stream.is_open())
+        throw Error(std::string("Failed to open ").append(_file));
+
+      if (!scanRecord(_fields))
+        throw Error(std::string("No Data in ").append(_file));
+
+      for (auto it = _fields.begin(); it != _fields.end(); it++)
+          _header.push_back(std::string(*it));
+  }
+
+  Reader::~Reader(void) {}
+
+  bool Reader::fill(void)
+  {
+      // slide the unread tail to the front, grow only if one record fills the buffer
+      if (_begin > 0)
+      {
+          std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+          _offset += _begin;
+          _end -= _begin;
+          _begin = 0;
+      }
+      if (_end == _buffer.size())
+          _buffer.resize(_buffer.size() * 2);
+
+      _stream.read(_buffer.data() + _end, _buffer.size() - _end);
+      size_t count = static_cast<size_t>(_stream.gcount());
+      _end += count;
+      if (count == 0)
+          _eof = true;
+      return count > 0;
+  }
+
+  bool Reader::nextRecord(std::vector<std::string_view> &fields)
+  {
+      if (_threads < 2)
+          return scanRecord(fields);
+
+      // hand out the records parsed from the window, and parse the next
+      // window once they are all gone
+      for (;;)
+      {
+          while (_chunk < _chunks.size())
+          {
+              const Chunk &chunk = _chunks[_chunk];
+              if (_record < chunk.starts.size())
+              {
+                  size_t first = chunk.starts[_record];
+                  size_t last = (_record + 1 < chunk.starts.size()) ? chunk.starts[_record + 1] : chunk.fields.size();
+                  fields.assign(chunk.fields.begin() + first, chunk.fields.begin() + last);
+                  _record++;
+                  return true;
+              }
+              _chunk++;
+              _record = 0;
+          }
+          if (!parseWindow())
+              return false;
+      }
+  }
+
+  bool Reader::scanRecord(std::vector<std::string_view> &fields)
+  {
+      for (;;)
+      {
+          // skip blank lines, the same as Parser
+          while (_begin != _end && _buffer[_begin] == '\n')
+              _begin++;
+
+          if (_begin == _end)
+          {
+              if (_eof || !fill())
+                  return false;
+              continue;
+          }
+
+          const char *begin = _buffer.data() + _begin;
+          const char *end = _buffer.data() + _end;
+
+          fields.clear();
+          const char *stop = parseRecord(begin, end, _sep, fields);
+
+          // a record cut off by the window is parsed again after reading
+          // more, or after hitting the end, since fill() moves the bytes
+          if (stop == end && !_eof)
+          {
+              fill();
+              continue;
+          }
+
+          _begin = (stop == end) ? _end : stop - _buffer.data() + 1;
+          return true;
+      }
+  }
+
+  bool Reader::parseWindow(void)
+  {
+      for (;;)
+      {
+          // the window only moves once every record in it is handed out
+          if (!_eof)
+              fill();
+
+          // skip blank lines, the same as Parser
+          while (_begin != _end && _buffer[_begin] == '\n')
+              _begin++;
+          if (_begin == _end)
+          {
+              if (_eof)
+                  return false;
+              continue;
+          }
+
+          const char *begin = _buffer.data() + _begin;
+          const char *end = _buffer.data() + _end;
+
+          // below about 1 MiB per chunk the threads cost more than they save
+          size_t chunks = std::min<size_t>(_threads, (end - begin) / (1 << 20) + 1);
+          std::vector<const char *> cuts;
+          if (chunks > 1)
+              cutChunks(begin, end, chunks, cuts);
+          else
+              cuts = { begin, end };
+
+          _chunks.resize(chunks);
+          std::vector<std::future<bool> > workers;
+          for (size_t c = 0; c < chunks; c++)
+          {
+              _chunks[c].fields.clear();
+              _chunks[c].starts.clear();
+              workers.push_back(std::async(chunks > 1 ? std::launch::async : std::launch::deferred,
+                                           [this, &cuts, c]() {
+                  return parseRecordsAt(cuts[c], cuts[c + 1], _sep, _chunks[c].fields, _chunks[c].starts);
+              }));
+          }
+
+          // only the last chunk with records can hold one cut off by the
+          // window, which is parsed again with the next one unless the
+          // file ends there
+          const char *stop = end;
+          size_t records = 0;
+          for (size_t c = 0; c < chunks; c++)
+          {
+              bool open = workers[c].get();
+              Chunk &chunk = _chunks[c];
+              if (open && !_eof && cuts[c + 1] == end)
+              {
+                  stop = chunk.fields[chunk.starts.back()].data();
+                  chunk.fields.resize(chunk.starts.back());
+                  chunk.starts.pop_back();
+              }
+              records += chunk.starts.size();
+          }
+
+          _begin = stop - _buffer.data();
+          _chunk = 0;
+          _record = 0;
+          if (records > 0)
+              return true;
+
+          // a record longer than the window, read more of it
+          if (_eof)
+              return false;
+      }
+  }
+
+  bool Reader::next(std::vector<std::string_view> &fields)
+  {
+      while (nextRecord(fields))
+      {
+          // if value(s) missing
+          if (fields.size() != _header.size())
+            throw Error("corrupted data !");
+          if (!_filter || _filter(fields))
+            return true;
+      }
+      return false;
+  }
+
+  bool Reader::next(Row &row)
+  {
+      if (!next(_fields))
+          return false;
+
+      row.clear();
+      for (auto it = _fields.begin(); it != _fields.end(); it++)
+          row.push(std::string(*it));
+      return true;
+  }
+
+  unsigned int Reader::columnCount(void) const
+  {
+      return _header.size();
+  }
+
+  const std::vector<std::string> &Reader::getHeader(void) const
+  {
+      return _header;
+  }
+
+  // exports pad some header names with blanks (and a CR on the last one)
+  static std::string_view trimBlanks(std::string_view text)
+  {
+      const char *blanks = " \t\r";
+      size_t first = text.find_first_not_of(blanks);
+      if (first == std::string_view::npos)
+          return std::string_view();
+      return text.substr(first, text.find_last_not_of(blanks) - first + 1);
+  }
+
+  // column position of a header name, -1 if absent, blanks ignored on both sides
+  int Reader::findColumn(std::string_view name) const
+  {
+      name = trimBlanks(name);
+      for (size_t i = 0; i < _header.size(); i++)
+          if (trimBlanks(_header[i]) == name)
+              return static_cast<int>(i);
+      return -1;
+  }
+
+  uint64_t Reader::offsetOf(std::string_view field) const
+  {
+      return _offset + (field.data() - _buffer.data());
+  }
+
+  const std::string &Reader::getFileName(void) const
+  {
+      return _file;
+  }
+
+  void Reader::setFilter(const Filter &filter)
+  {
+      _filter = filter;
+  }
 }
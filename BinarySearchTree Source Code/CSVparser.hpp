@@ -1,8 +1,13 @@
 #ifndef     _CSVPARSER_HPP_
 # define    _CSVPARSER_HPP_
 
+# include <cstddef>
+# include <cstdint>
+# include <fstream>
+# include <functional>
 # include <stdexcept>
 # include <string>
+# include <string_view>
 # include <vector>
 # include <list>
 # include <sstream>
@@ -27,11 +32,12 @@ namespace csv
 
     	public:
             unsigned int size(void) const;
-            void push(const std::string &);
+            void push(std::string);
+            void clear(void);
             bool set(const std::string &, const std::string &); 
 
     	private:
-    		const std::vector<std::string> _header;
+    		const std::vector<std::string> &_header; // shared, owned by the parser
     		std::vector<std::string> _values;
 
         public:
@@ -49,8 +55,8 @@ namespace csv
                 }
                 throw Error("can't return this value (doesn't exist)");
             }
-            const std::string operator[](unsigned int) const;
-            const std::string operator[](const std::string &valueName) const;
+            const std::string &operator[](unsigned int) const;
+            const std::string &operator[](const std::string &valueName) const;
             friend std::ostream& operator<<(std::ostream& os, const Row &row);
             friend std::ofstream& operator<<(std::ofstream& os, const Row &row);
     };
@@ -60,18 +66,25 @@ namespace csv
         ePURE = 1
     };
 
+    /*
+    ** Decides from the raw fields of a record whether it is kept; runs
+    ** before any field is copied, and the views die with the call
+    */
+    typedef std::function<bool(const std::vector<std::string_view> &)> Filter;
+
     class Parser
     {
 
     public:
-        Parser(const std::string &, const DataType &type = eFILE, char sep = ',');
+        Parser(const std::string &, const DataType &type = eFILE, char sep = ',',
+               const Filter &filter = Filter());
         ~Parser(void);
 
     public:
         Row &getRow(unsigned int row) const;
         unsigned int rowCount(void) const;
         unsigned int columnCount(void) const;
-        std::vector<std::string> getHeader(void) const;
+        const std::vector<std::string> &getHeader(void) const;
         const std::string getHeaderElement(unsigned int pos) const;
         const std::string &getFileName(void) const;
 
@@ -88,6 +101,7 @@ namespace csv
         std::string _file;
         const DataType _type;
         const char _sep;
+        const Filter _filter;
         std::vector<std::string> _originalFile;
         std::vector<std::string> _header;
         std::vector<Row *> _content;
@@ -95,6 +109,153 @@ namespace csv
     public:
         Row &operator[](unsigned int row) const;
     };
+
+    /*
+    ** Read-only view of a whole file mapped into memory
+    */
+    class MappedFile
+    {
+      public:
+        MappedFile(const std::string &);
+        ~MappedFile(void);
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+      public:
+        const char *data(void) const;
+        size_t size(void) const;
+
+      private:
+        const char *_data;
+        size_t _size;
+    };
+
+    /*
+    ** Split one record (without its newline) into fields pointing into
+    ** it, with the same quoting rules as MappedParser
+    */
+    void splitRecord(std::string_view, char sep, std::vector<std::string_view> &);
+
+    /*
+    ** Non-owning row handed out by MappedParser, fields point into the mapping
+    */
+    class RowView
+    {
+      public:
+        RowView(const std::string_view *values, unsigned int size);
+
+      public:
+        unsigned int size(void) const;
+        std::string_view operator[](unsigned int) const;
+
+      private:
+        const std::string_view *_values;
+        unsigned int _size;
+    };
+
+    /*
+    ** Zero-copy parser: maps the file and keeps string_view fields into it
+    ** instead of copying every cell into a Row. Fields keep their quotes,
+    ** the same as Parser, and quoted separators or newlines do not split.
+    ** Use Parser when owning strings or sync() are needed.
+    **
+    ** With threads > 1 (0 means one per core) the body is cut into chunks
+    ** at record boundaries and the chunks are parsed concurrently; the
+    ** fields come out in file order, identical to a serial parse.
+    */
+    class MappedParser
+    {
+
+    public:
+        MappedParser(const std::string &, char sep = ',', unsigned int threads = 1);
+        ~MappedParser(void);
+
+    public:
+        RowView getRow(unsigned int row) const;
+        unsigned int rowCount(void) const;
+        unsigned int columnCount(void) const;
+        const std::vector<std::string_view> &getHeader(void) const;
+        const std::string &getFileName(void) const;
+
+    protected:
+        void parseContent(void);
+        void parseChunks(const char *begin, const char *end);
+
+    private:
+        std::string _file;
+        const char _sep;
+        const unsigned int _threads;
+        MappedFile _map;
+        std::vector<std::string_view> _header;
+        std::vector<std::string_view> _fields; // row after row, columnCount() each
+
+    public:
+        RowView operator[](unsigned int row) const;
+    };
+
+    /*
+    ** Streaming reader: parses one record at a time from a fixed-size
+    ** window of the file, so memory stays bounded by the longest record
+    ** no matter how large the file is. Quoting rules match MappedParser.
+    **
+    ** With threads > 1 (0 means one per core) the window is that many
+    ** times larger, and each time it is refilled it is cut at record
+    ** boundaries into chunks parsed concurrently, the way MappedParser
+    ** cuts the whole file. A record cut off by the end of the window is
+    ** carried over to the next one. Records still come out one at a
+    ** time in file order, identical to a serial read.
+    */
+    class Reader
+    {
+
+    public:
+        Reader(const std::string &, char sep = ',', unsigned int threads = 1);
+        ~Reader(void);
+
+    public:
+        // string_view fields are only valid until the next call
+        bool next(std::vector<std::string_view> &);
+        bool next(Row &);
+        unsigned int columnCount(void) const;
+        const std::vector<std::string> &getHeader(void) const;
+        int findColumn(std::string_view name) const;
+        // position in the file of a field returned by the last next()
+        uint64_t offsetOf(std::string_view field) const;
+        const std::string &getFileName(void) const;
+        // records the filter rejects are skipped by both next()
+        void setFilter(const Filter &);
+
+    protected:
+        bool nextRecord(std::vector<std::string_view> &);
+        bool scanRecord(std::vector<std::string_view> &);
+        bool parseWindow(void);
+        bool fill(void);
+
+    private:
+        // records of one part of the window, parsed by one thread
+        struct Chunk
+        {
+            std::vector<std::string_view> fields;
+            std::vector<size_t> starts; // first field of each record
+        };
+
+        std::string _file;
+        const char _sep;
+        const unsigned int _threads;
+        std::ifstream _stream;
+        std::vector<char> _buffer;
+        uint64_t _offset; // position in the file of _buffer[0]
+        size_t _begin; // first unread byte in _buffer
+        size_t _end;   // one past the last byte read into _buffer
+        bool _eof;
+        std::vector<std::string> _header;
+        std::vector<std::string_view> _fields;
+        Filter _filter;
+        std::vector<Chunk> _chunks; // parsed but not handed out yet
+        size_t _chunk;  // chunk and record next() hands out next
+        size_t _record;
+    };
 }
 
 #endif /*!_CSVPARSER_HPP_*/
@@ -7,12 +7,27 @@
 //============================================================================
 
 #include <algorithm>
+#include <charconv>
 #include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <new>
 #include <string>
 #include <time.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "BPlusTree.hpp"
 #include "CSVparser.hpp"
+#include "OrderedIndex.hpp"
 
 using namespace std;
 
@@ -20,74 +35,611 @@ using namespace std;
 // Global definitions visible to all methods and classes
 //============================================================================
 
+// Money amount as a whole number of cents, so range bounds such as
+// $78.51 compare exactly
+struct Cents {
+    int64_t value;
+
+    Cents() {
+        value = 0;
+    }
+
+    explicit Cents(int64_t aValue) {
+        value = aValue;
+    }
+
+    bool operator==(Cents other) const { return value == other.value; }
+    bool operator!=(Cents other) const { return value != other.value; }
+    bool operator<(Cents other) const { return value < other.value; }
+    bool operator<=(Cents other) const { return value <= other.value; }
+    bool operator>(Cents other) const { return value > other.value; }
+    bool operator>=(Cents other) const { return value >= other.value; }
+};
+
+// Total, lowest and highest of a set of amounts, as the indexes keep
+// one for every subtree; the empty set has its lowest above its highest
+struct AmountSummary {
+    Cents total;
+    Cents lowest;
+    Cents highest;
+
+    AmountSummary() {
+        lowest = Cents(INT64_MAX);
+        highest = Cents(INT64_MIN);
+    }
+
+    explicit AmountSummary(Cents amount) {
+        total = amount;
+        lowest = amount;
+        highest = amount;
+    }
+
+    AmountSummary& operator+=(const AmountSummary& other) {
+        total.value += other.total.value;
+        lowest = std::min(lowest, other.lowest);
+        highest = std::max(highest, other.highest);
+        return *this;
+    }
+};
+
+// What a range query reports about the amounts of the bids in range
+struct AmountTotals {
+    unsigned int count;
+    Cents total;
+    Cents average; // rounded to the nearest cent
+    Cents lowest; // lowest, highest and average are 0 when count is 0
+    Cents highest;
+};
+
 // forward declarations
-double strToDouble(string str, char ch);
+Cents strToCents(string_view str);
+ostream& operator<<(ostream& out, Cents amount);
+char* centsToChars(char* first, char* last, Cents amount);
+
+/**
+ * Dictionary of the distinct values of a low-cardinality column
+ *
+ * Every distinct value is stored once and handed out as a small
+ * integer handle, so equal values compare as equal handles. Handle 0
+ * is always the empty value
+ */
+class Dictionary {
+
+private:
+    deque<string> values; // a deque never moves its strings
+    unordered_map<string_view, uint32_t> handles; // views into values
+
+public:
+    Dictionary();
+    uint32_t Intern(string_view value);
+    const string& operator[](uint32_t handle) const;
+};
+
+/**
+ * Default constructor
+ */
+Dictionary::Dictionary() {
+    this->Intern("");
+}
+
+/**
+ * Handle of a value, adding it on first sight
+ *
+ * @param value Text to look up
+ */
+uint32_t Dictionary::Intern(string_view value) {
+    auto found = handles.find(value);
+    if (found != handles.end()) {
+        return found->second;
+    }
+    values.emplace_back(value);
+    uint32_t handle = (uint32_t)(values.size() - 1);
+    handles.emplace(values.back(), handle);
+    return handle;
+}
+
+/**
+ * Value of a handle returned by Intern
+ *
+ * @param handle Handle to look up
+ */
+const string& Dictionary::operator[](uint32_t handle) const {
+    return values[handle];
+}
+
+// the funds bids are paid into, a handful across a whole export
+Dictionary fundNames;
 
 // define a structure to hold bid information
 struct Bid {
     string bidId; // unique identifier
     string title;
-    string fund;
-    double amount;
+    uint32_t fund; // handle in fundNames
+    Cents amount;
+
     Bid() {
-        amount = 0.0;
+        fund = 0;
     }
 };
 
-// Internal structure for tree node
-struct Node {
-    Bid bid;
-    Node* bidLeft;
-    Node* bidRight;
-    Node* amountParent;
-    Node* amountLeft;
-    Node* amountRight;
-
-    //default constructor
-    Node() {
-        bidLeft = nullptr;
-        bidRight = nullptr;
-        amountParent = nullptr;
-        amountLeft = nullptr;
-        amountRight = nullptr;
-    }
-
-    //destructor implementation
-    ~Node()
-    {
-        // if the left subtree is not null, delete it
-        if (bidLeft != nullptr)
-        {
-            delete bidLeft;
-        }
-        // if the right subtree is not null, delete it
-        if (bidRight != nullptr)
-        {
-            delete bidRight;
+/**
+ * Where each Bid field is read from: the header names its column goes
+ * by in the different eBid exports, and how the text is stored
+ *
+ * Columns are matched by name once per file, so the exports may order
+ * them differently, and only these columns are ever converted
+ */
+struct BidColumn {
+    const char* names[2]; // alternatives, unused ones are nullptr
+    void (*store)(Bid& bid, string_view text);
+};
+
+const BidColumn bidColumns[] = {
+    { { "ArticleID", "Auction ID" }, [](Bid& bid, string_view text) { bid.bidId = text; } },
+    { { "ArticleTitle", "Auction Title" }, [](Bid& bid, string_view text) { bid.title = text; } },
+    { { "Fund", nullptr }, [](Bid& bid, string_view text) { bid.fund = fundNames.Intern(text); } },
+    { { "WinningBid", "Winning Bid" }, [](Bid& bid, string_view text) { bid.amount = strToCents(text); } },
+};
+
+const size_t bidColumnCount = sizeof(bidColumns) / sizeof(bidColumns[0]);
+
+// the bidColumns entries a lazy load reads up front
+enum { ID_COLUMN = 0, AMOUNT_COLUMN = 3 };
+
+// Bid id in the form the indexes compare: ids that are plain decimal
+// numbers compare as integers, so 99999 sorts before 100000, and any
+// other id falls back to comparing its text after all numeric ids
+struct IdKey {
+    uint64_t number; // the id, or the length of text for other ids
+    const char* text; // nullptr when the id is numeric
+
+    IdKey() {
+        number = 0;
+        text = nullptr;
+    }
+
+    //the key refers to the id text, which must outlive it
+    explicit IdKey(string_view id) {
+        number = 0;
+        text = nullptr;
+
+        //leading zeros would make "007" equal "7", so those stay text
+        bool numeric = !id.empty() && id.size() <= 19 && (id[0] != '0' || id.size() == 1);
+        for (size_t i = 0; numeric && i < id.size(); i++) {
+            if (id[i] < '0' || id[i] > '9') {
+                numeric = false;
+                break;
+            }
+            number = number * 10 + (uint64_t)(id[i] - '0');
         }
-        // if the amount left subtree is not null, delete it
-        if (amountLeft != nullptr)
-        {
-            delete amountLeft;
+        if (!numeric) {
+            number = id.size();
+            text = id.data();
         }
-        // if the amount right subtree is not null, delete it
-        if (amountRight != nullptr)
-        {
-            delete amountRight;
+    }
+
+    int compare(const IdKey& other) const {
+        if (text == nullptr && other.text == nullptr) {
+            return (number > other.number) - (number < other.number);
         }
-        // if the amount parent subtree is not null, delete it
-        if (amountParent != nullptr)
-        {
-            delete amountParent;
+        if (text == nullptr || other.text == nullptr) {
+            return (text != nullptr) - (other.text != nullptr);
         }
+        return string_view(text, number).compare(string_view(other.text, other.number));
+    }
+
+    bool operator<(const IdKey& other) const {
+        return this->compare(other) < 0;
     }
+};
 
-    //initialize with a given bid
-    Node(Bid aBid) : Node() {
+// A bid as a lazy load keeps it: the two fields the indexes compare
+// and where the rest of it is in the source file
+struct BidRecord {
+    IdKey bidKey; // text ids point into the mapped source
+    Cents amount;
+    uint64_t offset; // of the record in the file
+    uint32_t length; // of the record, without its newline
+};
+
+// Internal structure for tree node, one per bid, indexed by both the
+// bid id order and the amount order
+//
+// The node holds only what the indexes compare, the rest of the bid
+// is either a full copy or, for a lazily loaded bid, its record in
+// the source file, decoded again whenever the bid is shown
+struct Node {
+    Bid* bid; // full copy, nullptr for a lazily loaded bid
+    IdKey bidKey; // bid id as compared by the bid id indexes
+    Cents amount; // winning bid as compared by the amount indexes
+    uint64_t offset; // lazily loaded record in the source
+    uint32_t length;
+    uint64_t seq; // insertion order, set by the tree, breaks every tie
+
+    //initialize with a full bid, which must outlive the node
+    explicit Node(Bid* aBid) {
         this->bid = aBid;
+        this->bidKey = IdKey(aBid->bidId);
+        this->amount = aBid->amount;
+        this->offset = 0;
+        this->length = 0;
+        this->seq = 0;
+    }
+
+    //initialize with a lazily loaded record
+    explicit Node(const BidRecord& record) {
+        this->bid = nullptr;
+        this->bidKey = record.bidKey;
+        this->amount = record.amount;
+        this->offset = record.offset;
+        this->length = record.length;
+        this->seq = 0;
     }
 };
 
+// Node of the red-black backend, which threads both trees through the
+// nodes themselves; the B+ backend keeps its links and summaries in
+// its own tree nodes, so it allocates plain Nodes and saves the 112
+// bytes per bid these take
+struct LinkedNode : Node {
+    IndexHook<LinkedNode> bidHook; // links in the bid id tree
+    IndexHook<LinkedNode> amountHook; // links in the amount tree
+    AmountSummary bidSummary; // amounts under the node in the bid id tree
+    AmountSummary amountSummary; // amounts under the node in the amount tree
+
+    using Node::Node;
+};
+
+// Key of both bid id indexes: the id, then the insertion sequence, so
+// bids sharing an id are distinct keys kept in the order they came in
+// and any position in the order can be found again by its key alone
+struct BidKey {
+    IdKey id;
+    uint64_t seq;
+    Node* node; // carried along by the B+ tree, never compared
+};
+
+struct BidKeyLess {
+    bool operator()(const BidKey& a, const BidKey& b) const {
+        int order = a.id.compare(b.id);
+        if (order != 0) {
+            return order < 0;
+        }
+        return a.seq < b.seq;
+    }
+
+    // a bare id is equivalent to every key holding it
+    bool operator()(const BidKey& a, const IdKey& b) const { return a.id.compare(b) < 0; }
+    bool operator()(const IdKey& a, const BidKey& b) const { return a.compare(b.id) < 0; }
+};
+
+// Key of both amount indexes, ties broken the same way
+struct AmountKey {
+    Cents amount;
+    uint64_t seq;
+    Node* node;
+};
+
+struct AmountKeyLess {
+    bool operator()(const AmountKey& a, const AmountKey& b) const {
+        if (a.amount != b.amount) {
+            return a.amount < b.amount;
+        }
+        return a.seq < b.seq;
+    }
+
+    // a bare amount is equivalent to every key holding it
+    bool operator()(const AmountKey& a, Cents b) const { return a.amount < b; }
+    bool operator()(Cents a, const AmountKey& b) const { return a < b.amount; }
+};
+
+// Key extractors, for the red-black indexes and the B+ tree keys alike
+struct BidIdOf {
+    BidKey operator()(Node* node) const { return BidKey{ node->bidKey, node->seq, node }; }
+};
+
+struct AmountOf {
+    AmountKey operator()(Node* node) const { return AmountKey{ node->amount, node->seq, node }; }
+};
+
+// Amount summaries of the red-black indexes, kept in the nodes
+struct BidTreeSummary {
+    typedef AmountSummary Summary;
+    Summary Element(const LinkedNode* node) const { return AmountSummary(node->amount); }
+    const Summary& Subtree(const LinkedNode* node) const { return node->bidSummary; }
+    void SetSubtree(LinkedNode* node, const Summary& subtree) const { node->bidSummary = subtree; }
+};
+
+struct AmountTreeSummary {
+    typedef AmountSummary Summary;
+    Summary Element(const LinkedNode* node) const { return AmountSummary(node->amount); }
+    const Summary& Subtree(const LinkedNode* node) const { return node->amountSummary; }
+    void SetSubtree(LinkedNode* node, const Summary& subtree) const { node->amountSummary = subtree; }
+};
+
+// The red-black indexes over the bid nodes; another ordering is one
+// more hook in LinkedNode and one more declaration here
+typedef OrderedIndex<LinkedNode, &LinkedNode::bidHook, BidIdOf, BidKeyLess, BidTreeSummary> BidIdIndex;
+typedef OrderedIndex<LinkedNode, &LinkedNode::amountHook, AmountOf, AmountKeyLess, AmountTreeSummary> AmountIndex;
+
+// The red-black node of a Node, which must come from the red-black backend
+inline LinkedNode* linked(Node* node) {
+    return static_cast<LinkedNode*>(node);
+}
+
+// Amount summaries of the B+ indexes, read through the keys
+struct KeySummary {
+    typedef AmountSummary Summary;
+    Summary Element(const BidKey& key) const { return AmountSummary(key.node->amount); }
+    Summary Element(const AmountKey& key) const { return AmountSummary(key.amount); }
+};
+
+// Index structure behind the bid id and amount lookups
+enum TreeBackend {
+    RED_BLACK, // pointer-linked red-black trees threaded through the nodes
+    B_PLUS     // wide-node B+ trees holding keys next to each other
+};
+
+//============================================================================
+// Slab pool class definition
+//============================================================================
+
+/**
+ * Slab allocator for tree nodes and the bids they own
+ *
+ * Items are carved out of large slabs instead of one heap allocation
+ * each, released items go on a free list for the next allocation, and
+ * all slabs are handed back at once when the tree is cleared
+ */
+template <typename Item>
+class SlabPool {
+
+private:
+    // a slot holds either a live item or the link to the next free slot
+    union Slot {
+        Slot* next;
+        alignas(Item) unsigned char storage[sizeof(Item)];
+    };
+
+    static const size_t slabSize = 1024; // items per slab
+
+    vector<Slot*> slabs;
+    Slot* freeList;
+    size_t used; // slots handed out from the newest slab
+
+public:
+    SlabPool();
+    virtual ~SlabPool();
+    template <typename Arg>
+    Item* Allocate(Arg&& arg);
+    void Release(Item* item);
+    void Clear();
+    size_t Capacity() const;
+};
+
+/**
+ * Default constructor
+ */
+template <typename Item>
+SlabPool<Item>::SlabPool() {
+    freeList = nullptr;
+    used = slabSize;
+}
+
+/**
+ * Destructor
+ */
+template <typename Item>
+SlabPool<Item>::~SlabPool() {
+    this->Clear();
+}
+
+/**
+ * Construct an item in the next free slot
+ *
+ * @param arg Constructor argument of the item, moved from if it can be
+ */
+template <typename Item>
+template <typename Arg>
+Item* SlabPool<Item>::Allocate(Arg&& arg) {
+    Slot* slot;
+
+    //reuse a released slot first, then carve from the newest slab
+    if (freeList != nullptr) {
+        slot = freeList;
+        freeList = slot->next;
+    }
+    else {
+        if (used == slabSize) {
+            slabs.push_back(new Slot[slabSize]);
+            used = 0;
+        }
+        slot = &slabs.back()[used++];
+    }
+    return new (slot->storage) Item(std::forward<Arg>(arg));
+}
+
+/**
+ * Destroy an item and put its slot on the free list
+ *
+ * @param item Item that is no longer referenced
+ */
+template <typename Item>
+void SlabPool<Item>::Release(Item* item) {
+    item->~Item();
+    Slot* slot = reinterpret_cast<Slot*>(item);
+    slot->next = freeList;
+    freeList = slot;
+}
+
+/**
+ * Hand every slab back to the heap
+ *
+ * Live items must already have been destroyed by the owner
+ */
+template <typename Item>
+void SlabPool<Item>::Clear() {
+    for (Slot* slab : slabs) {
+        delete[] slab;
+    }
+    slabs.clear();
+    freeList = nullptr;
+    used = slabSize;
+}
+
+/**
+ * Items the slabs carved so far have room for, live or free
+ */
+template <typename Item>
+size_t SlabPool<Item>::Capacity() const {
+    return slabs.size() * slabSize;
+}
+
+//============================================================================
+// Bid source class definition
+//============================================================================
+
+/**
+ * The export file a lazy load leaves its bids in
+ *
+ * The file is mapped rather than read, so the records cost address
+ * space until a bid is shown, and only then is its record split again
+ * and its fields converted
+ */
+class BidSource {
+
+private:
+    csv::MappedFile file;
+    size_t columns[bidColumnCount]; // position of each bidColumns field
+    vector<string_view> fields; // scratch for Decode
+
+public:
+    BidSource(const string& csvPath, const size_t* aColumns);
+    const char* Data() const;
+    void Decode(uint64_t offset, uint32_t length, Bid& bid);
+};
+
+/**
+ * Map an export whose columns have already been found
+ *
+ * @param csvPath the path to the CSV file
+ * @param aColumns Column of each bidColumns field in that file
+ */
+BidSource::BidSource(const string& csvPath, const size_t* aColumns) : file(csvPath) {
+    std::copy(aColumns, aColumns + bidColumnCount, columns);
+}
+
+/**
+ * First byte of the mapped file
+ */
+const char* BidSource::Data() const {
+    return file.data();
+}
+
+/**
+ * Rebuild a bid from its record
+ *
+ * @param offset Where the record starts in the file
+ * @param length Bytes in the record
+ * @param bid Bid to fill in
+ */
+void BidSource::Decode(uint64_t offset, uint32_t length, Bid& bid) {
+    csv::splitRecord(string_view(file.data() + offset, length), ',', fields);
+    for (size_t i = 0; i < bidColumnCount; i++) {
+        bidColumns[i].store(bid, fields[columns[i]]);
+    }
+}
+
+//============================================================================
+// Bid writer class definition
+//============================================================================
+
+// What the traversals hand each bid to, in the traversal's order
+typedef std::function<void(const Bid&)> BidVisitor;
+
+// What a bulk load takes bids from: fills in the next bid and returns
+// true, or returns false once there are no more
+typedef std::function<bool(Bid&)> BidReader;
+
+/**
+ * Renders bids as "id: title| amount| fund" lines
+ *
+ * The lines are formatted into one large buffer, amounts with
+ * to_chars, and the buffer goes to the stream in a single write when
+ * full or flushed, instead of a stream insertion per field and a
+ * flush per line
+ */
+class BidWriter {
+
+private:
+    ostream& out;
+    vector<char> buffer;
+    size_t used; // bytes formatted but not written yet
+
+public:
+    BidWriter(ostream& aOut);
+    virtual ~BidWriter();
+    void Write(const Bid& bid);
+    void Flush();
+};
+
+/**
+ * Constructor
+ *
+ * @param aOut Stream the lines go to
+ */
+BidWriter::BidWriter(ostream& aOut) : out(aOut), buffer(1 << 16) {
+    used = 0;
+}
+
+/**
+ * Destructor
+ */
+BidWriter::~BidWriter() {
+    this->Flush();
+}
+
+/**
+ * Format one bid at the end of the buffer
+ *
+ * @param bid Bid to render
+ */
+void BidWriter::Write(const Bid& bid) {
+    const string& fund = fundNames[bid.fund];
+
+    //the texts plus separators, newline and the widest amount
+    size_t length = bid.bidId.size() + bid.title.size() + fund.size() + 32;
+    if (used + length > buffer.size()) {
+        this->Flush();
+        if (length > buffer.size()) {
+            buffer.resize(length);
+        }
+    }
+
+    char* at = buffer.data() + used;
+    at = std::copy(bid.bidId.begin(), bid.bidId.end(), at);
+    *at++ = ':';
+    *at++ = ' ';
+    at = std::copy(bid.title.begin(), bid.title.end(), at);
+    *at++ = '|';
+    *at++ = ' ';
+    at = centsToChars(at, buffer.data() + buffer.size(), bid.amount);
+    *at++ = '|';
+    *at++ = ' ';
+    at = std::copy(fund.begin(), fund.end(), at);
+    *at++ = '\n';
+    used = at - buffer.data();
+}
+
+/**
+ * Write out everything formatted so far
+ */
+void BidWriter::Flush() {
+    out.write(buffer.data(), used);
+    out.flush();
+    used = 0;
+}
+
 //============================================================================
 // Binary Search Tree class definition
 //============================================================================
@@ -95,301 +647,1139 @@ struct Node {
 /**
  * Define a class containing data members and methods to
  * implement a binary search tree
+ *
+ * Both the bid id tree and the amount tree are kept balanced as
+ * red-black trees so that inserts, removals and searches stay
+ * O(log n) even when the CSV export is already sorted by auction id
+ * or many bids share the same winning amount
+ *
+ * The B_PLUS backend indexes smaller nodes, without the red-black
+ * links and summaries, with two B+ trees instead, trading pointer
+ * chasing for scans of wide nodes
+ *
+ * Freeze() additionally copies both indexes into flat arrays in
+ * Eytzinger (breadth-first) order for read-mostly sessions; searches
+ * use them until the next insert, remove or clear
+ *
+ * A lazy BulkLoad keeps only ids, amounts and record positions in the
+ * nodes and leaves the rest of each bid in a mapped BidSource
+ *
+ * Both orders can also be walked with bidirectional iterators, which
+ * any insert, remove or clear invalidates, or paged through with
+ * cursors, which carry on from where they were across such changes
+ *
+ * Every index counts the bids under each of its nodes, so the rank of
+ * a bid, the bid at a rank and the number of bids in a range of ids or
+ * amounts all take O(log n) whatever the number of bids involved; it
+ * also sums up their amounts, so range totals take O(log n) as well
  */
 class BinarySearchTree {
 
 private:
-    Node* root;
-    Node* amountRoot;
+    TreeBackend backend;
+    BidIdIndex bidTree;
+    AmountIndex amountTree;
+    BPlusTree<BidKey, BidKeyLess, 16, KeySummary> bidIndex;
+    BPlusTree<AmountKey, AmountKeyLess, 32, KeySummary> amountIndex;
+    SlabPool<Node> pool; // nodes of the B+ backend
+    SlabPool<LinkedNode> linkedPool; // nodes of the red-black backend
+    SlabPool<Bid> bidPool; // full copies owned by the nodes
+    BidSource* source; // records of lazily loaded bids, or nullptr
+    mutable Bid decoded; // last lazily loaded bid handed out by bidOf
+    unsigned int size; // bids currently linked into both indexes
+    unsigned long version; // bumped by every change to the indexes
+    uint64_t sequence; // seq of the next node, never handed out twice
+
+    // frozen copies of the indexes, slot 0 of each Eytzinger array is unused
+    bool frozen;
+    vector<uint64_t> frozenNumbers;        // numeric bid ids in Eytzinger order
+    vector<string_view> frozenTexts;       // text bid ids, sorted
+    vector<Cents> frozenAmounts;           // amounts in Eytzinger order
+    vector<unsigned int> frozenRanks;      // sorted position of each slot
+    vector<Node*> frozenAmountNodes;       // nodes sorted by amount
+
+    Node* findBid(const string& bidId);
+    template <typename From> Node* allocateNode(const From& from);
+    const Bid& bidOf(Node* node) const;
+    void buildIndexes(vector<Node*>& byId);
+    void removeNode(Node* node);
+    void thaw();
+
+public:
+    // the two orders iterators and cursors can follow
+    struct ByBidId;
+    struct ByAmount;
+    template <typename Ordering> class OrderIterator;
+    template <typename Ordering> class OrderCursor;
+
+    typedef OrderIterator<ByBidId> BidIterator;
+    typedef OrderIterator<ByAmount> AmountIterator;
+    typedef std::reverse_iterator<BidIterator> ReverseBidIterator;
+    typedef std::reverse_iterator<AmountIterator> ReverseAmountIterator;
+    typedef OrderCursor<ByBidId> BidCursor;
+    typedef OrderCursor<ByAmount> AmountCursor;
+
+private:
+    vector<BidIterator> frozenNumberBids;  // bid of each frozenNumbers slot
+    vector<BidIterator> frozenTextBids;    // bid of each frozenTexts entry
+
+    BidIterator frozenLowerBound(const IdKey& key) const;
+    template <typename Ordering> OrderIterator<Ordering> begin() const;
+    template <typename Ordering> OrderIterator<Ordering> end() const;
+    template <typename Ordering, typename K> OrderIterator<Ordering> lowerBound(const K& key) const;
+    template <typename Ordering, typename K> OrderIterator<Ordering> upperBound(const K& key) const;
+    template <typename Ordering> unsigned int rank(const OrderIterator<Ordering>& it) const;
+    template <typename Ordering> OrderIterator<Ordering> select(unsigned int index) const;
+    template <typename Ordering, typename K> unsigned int countBetween(const K& low, const K& high) const;
+    template <typename Ordering, typename K> AmountTotals totalsBetween(const K& low, const K& high) const;
+
+public:
+    BinarySearchTree(TreeBackend aBackend = RED_BLACK);
+    virtual ~BinarySearchTree();
+    void Clear();
+    void Freeze();
+    void BulkLoad(const BidReader& read);
+    void BulkLoad(BidSource* aSource, const vector<BidRecord>& records);
+    void InBidOrder(const BidVisitor& visit);
+    void InAmountOrder(const BidVisitor& visit);
+    void Insert(Bid bid);
+    bool Remove(string bidId);
+    unsigned int Size();
+    size_t Capacity() const;
+    Bid BidSearch(string bidId);
+    void AmountSearch(Cents lowAmount, Cents highAmount, const BidVisitor& visit);
+
+    BidIterator BidBegin() const;
+    BidIterator BidEnd() const;
+    BidIterator BidLowerBound(const string& bidId) const;
+    BidIterator BidUpperBound(const string& bidId) const;
+    std::pair<BidIterator, BidIterator> BidEqualRange(const string& bidId) const;
+    AmountIterator AmountBegin() const;
+    AmountIterator AmountEnd() const;
+    AmountIterator AmountLowerBound(Cents amount) const;
+    AmountIterator AmountUpperBound(Cents amount) const;
+    std::pair<AmountIterator, AmountIterator> AmountEqualRange(Cents amount) const;
+
+    unsigned int Rank(const BidIterator& it) const;
+    unsigned int Rank(const AmountIterator& it) const;
+    BidIterator BidSelect(unsigned int index) const;
+    AmountIterator AmountSelect(unsigned int index) const;
+    unsigned int CountInRange(const string& lowId, const string& highId) const;
+    unsigned int CountInRange(Cents lowAmount, Cents highAmount) const;
+    AmountTotals TotalsInRange(const string& lowId, const string& highId) const;
+    AmountTotals TotalsInRange(Cents lowAmount, Cents highAmount) const;
+};
+
+// How iterators reach the bid id order in either backend
+struct BinarySearchTree::ByBidId {
+    typedef BidIdIndex Index;
+    typedef BPlusTree<BidKey, BidKeyLess, 16, KeySummary> Tree;
+    typedef string Saved; // id a cursor keeps, so it outlives the node
+
+    static const Index& index(const BinarySearchTree& bst) { return bst.bidTree; }
+    static const Tree& tree(const BinarySearchTree& bst) { return bst.bidIndex; }
+
+    static void save(const Node* node, Saved& saved) {
+        const IdKey& id = node->bidKey;
+        saved = (id.text == nullptr) ? std::to_string(id.number) : string(id.text, id.number);
+    }
+
+    // the saved id must outlive the key
+    static BidKey key(const Saved& saved, uint64_t seq) { return BidKey{ IdKey(saved), seq, nullptr }; }
+};
+
+// How iterators reach the amount order in either backend
+struct BinarySearchTree::ByAmount {
+    typedef AmountIndex Index;
+    typedef BPlusTree<AmountKey, AmountKeyLess, 32, KeySummary> Tree;
+    typedef Cents Saved;
+
+    static const Index& index(const BinarySearchTree& bst) { return bst.amountTree; }
+    static const Tree& tree(const BinarySearchTree& bst) { return bst.amountIndex; }
+    static void save(const Node* node, Saved& saved) { saved = node->amount; }
+    static AmountKey key(const Saved& saved, uint64_t seq) { return AmountKey{ saved, seq, nullptr }; }
+};
+
+/**
+ * Bidirectional iterator over the bids in one order
+ *
+ * Dereferencing gives the bid itself for a fully loaded bid; a lazily
+ * loaded one is decoded on each access and stays valid only until the
+ * next. Any insert, remove or clear invalidates every iterator
+ */
+template <typename Ordering>
+class BinarySearchTree::OrderIterator {
+    friend class BinarySearchTree;
+
+private:
+    typedef typename Ordering::Tree::Position Position;
+
+    const BinarySearchTree* tree;
+    Node* node; // current bid, nullptr past the last one
+    Position pos; // the same bid in the B+ backend
+
+    OrderIterator(const BinarySearchTree* aTree, Node* aNode) {
+        tree = aTree;
+        node = aNode;
+    }
+
+    OrderIterator(const BinarySearchTree* aTree, Position aPos) {
+        tree = aTree;
+        pos = aPos;
+        node = pos.IsValid() ? pos.Value().node : nullptr;
+    }
+
+public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef Bid value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const Bid* pointer;
+    typedef const Bid& reference;
+
+    OrderIterator() {
+        tree = nullptr;
+        node = nullptr;
+    }
+
+    reference operator*() const {
+        return tree->bidOf(node);
+    }
+
+    pointer operator->() const {
+        return &tree->bidOf(node);
+    }
+
+    // the amount straight from the node, without decoding a lazy bid
+    Cents Amount() const {
+        return node->amount;
+    }
+
+    OrderIterator& operator++() {
+        if (tree->backend == B_PLUS) {
+            pos.Next();
+            node = pos.IsValid() ? pos.Value().node : nullptr;
+        }
+        else {
+            node = Ordering::Index::Next(linked(node));
+        }
+        return *this;
+    }
+
+    OrderIterator operator++(int) {
+        OrderIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    //stepping back from the end lands on the last bid
+    OrderIterator& operator--() {
+        if (tree->backend == B_PLUS) {
+            if (pos.IsValid()) {
+                pos.Prev();
+            }
+            else {
+                pos = Ordering::tree(*tree).Last();
+            }
+            node = pos.IsValid() ? pos.Value().node : nullptr;
+        }
+        else {
+            node = (node != nullptr) ? Ordering::Index::Prev(linked(node)) : Ordering::index(*tree).Last();
+        }
+        return *this;
+    }
+
+    OrderIterator operator--(int) {
+        OrderIterator old = *this;
+        --*this;
+        return old;
+    }
+
+    bool operator==(const OrderIterator& other) const {
+        return node == other.node;
+    }
+
+    bool operator!=(const OrderIterator& other) const {
+        return node != other.node;
+    }
+};
+
+/**
+ * Resumable walk through one order, handed out a page at a time
+ *
+ * Between pages the cursor holds its place like an iterator, so the
+ * next page starts there instead of searching from the root. When the
+ * tree has changed in between, it searches once for the first bid
+ * after the full key, sequence included, of the last bid it handed
+ * out, so removals and equal keys inserted since cannot make it skip
+ * or repeat a bid
+ */
+template <typename Ordering>
+class BinarySearchTree::OrderCursor {
+
+private:
+    const BinarySearchTree* tree;
+    OrderIterator<Ordering> position;
+    unsigned long version; // tree version position belongs to
+    bool keyed; // false until a bid lies behind the cursor
+    typename Ordering::Saved last; // key of the bid just behind
+    uint64_t lastSeq; // and its sequence
+
+    void resume();
+
+public:
+    OrderCursor(const BinarySearchTree& aTree);
+    OrderCursor(const BinarySearchTree& aTree, OrderIterator<Ordering> from);
+    size_t Next(size_t count, const BidVisitor& visit);
+    bool AtEnd();
+};
+
+/**
+ * Cursor at the first bid
+ *
+ * @param aTree Tree to walk
+ */
+template <typename Ordering>
+BinarySearchTree::OrderCursor<Ordering>::OrderCursor(const BinarySearchTree& aTree)
+    : OrderCursor(aTree, aTree.begin<Ordering>()) {
+}
+
+/**
+ * Cursor at an iterator's bid
+ *
+ * @param aTree Tree to walk
+ * @param from Where the first page starts
+ */
+template <typename Ordering>
+BinarySearchTree::OrderCursor<Ordering>::OrderCursor(const BinarySearchTree& aTree, OrderIterator<Ordering> from) {
+    tree = &aTree;
+    position = from;
+    version = aTree.version;
+    keyed = false;
+    lastSeq = 0;
+
+    //note what lies just behind the start, in case the tree changes
+    //before the first page
+    if (from != aTree.begin<Ordering>()) {
+        OrderIterator<Ordering> back = from;
+        --back;
+        Ordering::save(back.node, last);
+        lastSeq = back.node->seq;
+        keyed = true;
+    }
+}
+
+/**
+ * Hand out the next bids
+ *
+ * @param count Most bids to hand out
+ * @param visit Called with each, as for InBidOrder
+ * @return how many were handed out, fewer than count at the end
+ */
+template <typename Ordering>
+size_t BinarySearchTree::OrderCursor<Ordering>::Next(size_t count, const BidVisitor& visit) {
+    this->resume();
+
+    OrderIterator<Ordering> end = tree->end<Ordering>();
+    Node* previous = nullptr;
+    size_t visited = 0;
+    for (; visited < count && position != end; visited++, ++position) {
+        previous = position.node;
+        visit(*position);
+    }
+
+    //the key is copied once a page, not once a bid
+    if (previous != nullptr) {
+        Ordering::save(previous, last);
+        lastSeq = previous->seq;
+        keyed = true;
+    }
+    return visited;
+}
+
+/**
+ * Whether every bid has been handed out
+ */
+template <typename Ordering>
+bool BinarySearchTree::OrderCursor<Ordering>::AtEnd() {
+    this->resume();
+    return position == tree->end<Ordering>();
+}
+
+/**
+ * Find the place again after the tree has changed
+ */
+template <typename Ordering>
+void BinarySearchTree::OrderCursor<Ordering>::resume() {
+    if (version == tree->version) {
+        return;
+    }
+    version = tree->version;
+
+    //sequences only grow, so bids inserted since with the same key come
+    //after the last one handed out, whether or not it is still there
+    if (keyed) {
+        position = tree->upperBound<Ordering>(Ordering::key(last, lastSeq));
+    }
+    else {
+        position = tree->begin<Ordering>();
+    }
+}
+
+/**
+ * Default constructor
+ *
+ * @param aBackend Index structure to keep the bids in
+ */
+BinarySearchTree::BinarySearchTree(TreeBackend aBackend) {
+    // initialize housekeeping variables
+    backend = aBackend;
+    source = nullptr;
+    size = 0;
+    version = 0;
+    sequence = 0;
+    frozen = false;
+}
+
+/**
+ * Destructor
+ */
+BinarySearchTree::~BinarySearchTree() {
+    this->Clear();
+}
+
+/**
+ * Remove every bid and release the node pool in one go
+ */
+void BinarySearchTree::Clear() {
+    this->thaw();
+
+    //full bids own strings, so each is still destroyed before the
+    //slabs themselves are freed in bulk; every node is in the bid id
+    //tree, so walking that one tree reaches them all
+    auto dispose = [](Node* node) {
+        if (node->bid != nullptr) {
+            node->bid->~Bid();
+        }
+    };
+    if (backend == B_PLUS) {
+        for (auto pos = bidIndex.Begin(); pos.IsValid(); pos.Next()) {
+            dispose(pos.Value().node);
+        }
+        bidIndex.Clear();
+        amountIndex.Clear();
+    }
+    else {
+        bidTree.ClearAndDispose(dispose);
+        amountTree.Clear();
+    }
+    pool.Clear();
+    linkedPool.Clear();
+    bidPool.Clear();
+    size = 0;
+    version++;
+
+    delete source;
+    source = nullptr;
+}
 
-    void addBid(Node* node, Bid bid);
-    void inBidOrder(Node* node);
-    void addAmountNode(Node* node, Bid bid);
-    void inAmountOrder(Node* node);
-    void amountSearch(Node* node, double lowAmount, double highAmount);
-    Node* removeNode(Node* node, string bidId);
+/**
+ * Compact both indexes into Eytzinger arrays for fast read-only searches
+ *
+ * BidSearch, BidLowerBound, Remove and AmountSearch use the arrays until
+ * the next mutation, which drops them again. Numeric ids are searched
+ * as plain integers, without a branch on the kind of id per probe; the
+ * few text ids get a sorted array of their own
+ */
+void BinarySearchTree::Freeze() {
+    this->thaw();
+
+    //collect the bids in id order and the nodes in amount order
+    vector<BidIterator> byId;
+    vector<Node*> byAmount;
+    byId.reserve(size);
+    byAmount.reserve(size);
+    for (BidIterator it = this->BidBegin(), end = this->BidEnd(); it != end; ++it) {
+        byId.push_back(it);
+    }
+    for (AmountIterator it = this->AmountBegin(), end = this->AmountEnd(); it != end; ++it) {
+        byAmount.push_back(it.node);
+    }
 
+    //every numeric id sorts before every text id
+    size_t numbers = 0;
+    while (numbers < byId.size() && byId[numbers].node->bidKey.text == nullptr) {
+        numbers++;
+    }
+    vector<unsigned int> numberRanks;
+    eytzingerOrder(numberRanks, numbers);
+    frozenNumbers.resize(numbers + 1);
+    frozenNumberBids.resize(numbers + 1);
+    for (size_t k = 1; k <= numbers; k++) {
+        frozenNumberBids[k] = byId[numberRanks[k]];
+        frozenNumbers[k] = frozenNumberBids[k].node->bidKey.number;
+    }
+    for (size_t i = numbers; i < byId.size(); i++) {
+        const IdKey& id = byId[i].node->bidKey;
+        frozenTexts.push_back(string_view(id.text, id.number));
+        frozenTextBids.push_back(byId[i]);
+    }
+
+    eytzingerOrder(frozenRanks, size);
+    frozenAmounts.resize(size + 1);
+    for (size_t k = 1; k <= size; k++) {
+        frozenAmounts[k] = byAmount[frozenRanks[k]]->amount;
+    }
+    frozenAmountNodes.swap(byAmount);
+
+    frozen = true;
+}
+
+/**
+ * Replace the contents with a batch of bids in O(n log n) total
+ *
+ * Each bid is moved into the pool as soon as it is read, so the batch
+ * is never held anywhere else. The nodes are then sorted by id and by
+ * amount (the two sorts run side by side) and each index is built
+ * bottom-up in linear time, already perfectly balanced, instead of one
+ * rebalancing insert per bid
+ *
+ * If read throws, the bids read before are still loaded and the
+ * exception is passed on
+ *
+ * @param read Called for each bid to load, in file order
+ */
+void BinarySearchTree::BulkLoad(const BidReader& read) {
+    this->Clear();
+
+    vector<Node*> byId;
+    Bid bid;
+    try {
+        while (read(bid)) {
+            byId.push_back(this->allocateNode(bidPool.Allocate(std::move(bid))));
+            bid = Bid();
+        }
+    }
+    catch (...) {
+        this->buildIndexes(byId);
+        throw;
+    }
+    this->buildIndexes(byId);
+}
+
+/**
+ * Replace the contents with lazily loaded bids
+ *
+ * The tree takes over the source, which must hold every record, and
+ * keeps it until it is cleared
+ *
+ * @param aSource Mapped file the records are in
+ * @param records Bids to load, in file order
+ */
+void BinarySearchTree::BulkLoad(BidSource* aSource, const vector<BidRecord>& records) {
+    this->Clear();
+    source = aSource;
+
+    vector<Node*> byId;
+    byId.reserve(records.size());
+    for (const BidRecord& record : records) {
+        byId.push_back(this->allocateNode(record));
+    }
+    this->buildIndexes(byId);
+}
+
+/**
+ * Traverse the tree bids in order
+ *
+ * @param visit Called with each bid, which for a lazily loaded bid is
+ *              only valid during the call
+ */
+void BinarySearchTree::InBidOrder(const BidVisitor& visit) {
+    //the iterators follow successor links rather than recursing, so
+    //deep trees cannot overflow the stack
+    for (BidIterator it = this->BidBegin(), end = this->BidEnd(); it != end; ++it) {
+        visit(*it);
+    }
+}
+
+/**
+ * Traverse the tree amounts in order
+ *
+ * @param visit Called with each bid, as for InBidOrder
+ */
+void BinarySearchTree::InAmountOrder(const BidVisitor& visit) {
+    for (AmountIterator it = this->AmountBegin(), end = this->AmountEnd(); it != end; ++it) {
+        visit(*it);
+    }
+}
+
+/**
+ * Insert a bid
+ * 
+ * @param bid Bid to insert
+ */
+void BinarySearchTree::Insert(Bid bid) {
+
+    //one node per bid, threaded into both trees
+    this->thaw();
+    Node* added = this->allocateNode(bidPool.Allocate(std::move(bid)));
+    if (backend == B_PLUS) {
+        bidIndex.Insert(BidIdOf()(added));
+        amountIndex.Insert(AmountOf()(added));
+    }
+    else {
+        bidTree.Insert(linked(added));
+        amountTree.Insert(linked(added));
+    }
+    size++;
+    version++;
+}
+
+/**
+ * Remove a bid from both the bid id tree and the amount tree
+ * 
+ * @param bidId Bid id to remove
+ * @return true if a bid was found and removed
+ */
+bool BinarySearchTree::Remove(string bidId) {
+    Node* node = this->findBid(bidId);
+    if (node == nullptr) {
+        return false;
+    }
+    this->removeNode(node);
+    return true;
+}
+
+/**
+ * Number of bids in the tree
+ */
+unsigned int BinarySearchTree::Size() {
+    return size;
+}
+
+/**
+ * Bids the node pool has room for before it takes more memory
+ */
+size_t BinarySearchTree::Capacity() const {
+    return (backend == B_PLUS) ? pool.Capacity() : linkedPool.Capacity();
+}
+
+/**
+ * Search for a bid
+ * 
+ * @param bidId Bid id to search for
+ */
+Bid BinarySearchTree::BidSearch(string bidId) {
+
+    Node* node = this->findBid(bidId);
+    if (node != nullptr) {
+        return this->bidOf(node);
+    }
+
+    Bid bid;
+    return bid;
+}
+
+/**
+ * Search for bids within a range of values
+ * 
+ * @param lowAmount Low amount of range
+ * @param highAmount High amount of range
+ * @param visit Called with each bid in range, as for InBidOrder
+ */
+void BinarySearchTree::AmountSearch(Cents lowAmount, Cents highAmount, const BidVisitor& visit) {
+    if (frozen) {
+        //the frozen slot only tells where to start in the sorted nodes
+        size_t slot = eytzingerLowerBound(frozenAmounts, lowAmount);
+        if (slot == 0) {
+            return;
+        }
+        for (size_t i = frozenRanks[slot]; i < frozenAmountNodes.size()
+            && frozenAmountNodes[i]->amount <= highAmount; i++) {
+            visit(this->bidOf(frozenAmountNodes[i]));
+        }
+        return;
+    }
+
+    //descend to the first amount not below the low end of the range,
+    //then walk forward in amount order until past the high end
+    AmountIterator end = this->AmountEnd();
+    for (AmountIterator it = this->AmountLowerBound(lowAmount); it != end && it.Amount() <= highAmount; ++it) {
+        visit(*it);
+    }
+}
+
+/**
+ * First bid in id order
+ */
+BinarySearchTree::BidIterator BinarySearchTree::BidBegin() const {
+    return this->begin<ByBidId>();
+}
+
+/**
+ * Position past the last bid in id order
+ */
+BinarySearchTree::BidIterator BinarySearchTree::BidEnd() const {
+    return this->end<ByBidId>();
+}
+
+/**
+ * First bid whose id is not less than bidId
+ *
+ * @param bidId Bid id to search for
+ */
+BinarySearchTree::BidIterator BinarySearchTree::BidLowerBound(const string& bidId) const {
+    if (frozen) {
+        return this->frozenLowerBound(IdKey(bidId));
+    }
+    return this->lowerBound<ByBidId>(IdKey(bidId));
+}
+
+/**
+ * First bid whose id is greater than bidId
+ *
+ * @param bidId Bid id to search for
+ */
+BinarySearchTree::BidIterator BinarySearchTree::BidUpperBound(const string& bidId) const {
+    return this->upperBound<ByBidId>(IdKey(bidId));
+}
+
+/**
+ * Every bid with the given id, as [first, last)
+ *
+ * @param bidId Bid id to search for
+ */
+std::pair<BinarySearchTree::BidIterator, BinarySearchTree::BidIterator>
+BinarySearchTree::BidEqualRange(const string& bidId) const {
+    IdKey key(bidId);
+    return std::make_pair(this->lowerBound<ByBidId>(key), this->upperBound<ByBidId>(key));
+}
+
+/**
+ * Lowest bid in amount order
+ */
+BinarySearchTree::AmountIterator BinarySearchTree::AmountBegin() const {
+    return this->begin<ByAmount>();
+}
+
+/**
+ * Position past the highest bid in amount order
+ */
+BinarySearchTree::AmountIterator BinarySearchTree::AmountEnd() const {
+    return this->end<ByAmount>();
+}
+
+/**
+ * First bid whose amount is not less than amount
+ *
+ * @param amount Amount to search for
+ */
+BinarySearchTree::AmountIterator BinarySearchTree::AmountLowerBound(Cents amount) const {
+    return this->lowerBound<ByAmount>(amount);
+}
+
+/**
+ * First bid whose amount is greater than amount
+ *
+ * @param amount Amount to search for
+ */
+BinarySearchTree::AmountIterator BinarySearchTree::AmountUpperBound(Cents amount) const {
+    return this->upperBound<ByAmount>(amount);
+}
 
-public:
-    BinarySearchTree();
-    virtual ~BinarySearchTree();
-    void InBidOrder();
-    void InAmountOrder();
-    void Insert(Bid bid);
-    void Remove(string bidId);
-    Bid BidSearch(string bidId);
-    void AmountSearch(double lowAmount, double highAmount);
+/**
+ * Every bid with exactly the given amount, as [first, last)
+ *
+ * @param amount Amount to search for
+ */
+std::pair<BinarySearchTree::AmountIterator, BinarySearchTree::AmountIterator>
+BinarySearchTree::AmountEqualRange(Cents amount) const {
+    return std::make_pair(this->lowerBound<ByAmount>(amount), this->upperBound<ByAmount>(amount));
+}
 
-};
+/**
+ * Position of a bid in id order, counting from 0
+ *
+ * @param it Bid to look up, BidEnd() gives Size()
+ */
+unsigned int BinarySearchTree::Rank(const BidIterator& it) const {
+    return this->rank(it);
+}
 
 /**
- * Default constructor
+ * Position of a bid in amount order, counting from 0
+ *
+ * @param it Bid to look up, AmountEnd() gives Size()
  */
-BinarySearchTree::BinarySearchTree() {
-    // initialize housekeeping variables
-    root = nullptr;
-    amountRoot = nullptr;
+unsigned int BinarySearchTree::Rank(const AmountIterator& it) const {
+    return this->rank(it);
 }
 
 /**
- * Destructor
+ * Bid at a position in id order
+ *
+ * @param index Position counting from 0, BidEnd() when not below Size()
  */
-BinarySearchTree::~BinarySearchTree() {
-    // recurse from root deleting every node
-    if (root != nullptr) {
-        this->removeNode(root, root->bid.bidId);
-        this->removeNode(amountRoot, amountRoot->bid.bidId);
-    }
+BinarySearchTree::BidIterator BinarySearchTree::BidSelect(unsigned int index) const {
+    return this->select<ByBidId>(index);
+}
 
+/**
+ * Bid at a position in amount order, e.g. Size() / 2 for the median
+ *
+ * @param index Position counting from 0, AmountEnd() when not below Size()
+ */
+BinarySearchTree::AmountIterator BinarySearchTree::AmountSelect(unsigned int index) const {
+    return this->select<ByAmount>(index);
 }
 
 /**
- * Traverse the tree bids in order
+ * Number of bids with ids from lowId to highId, both included
+ *
+ * @param lowId Low end of the range
+ * @param highId High end of the range
  */
-void BinarySearchTree::InBidOrder() {
-    this->inBidOrder(root);
+unsigned int BinarySearchTree::CountInRange(const string& lowId, const string& highId) const {
+    return this->countBetween<ByBidId>(IdKey(lowId), IdKey(highId));
+}
 
+/**
+ * Number of bids with amounts from lowAmount to highAmount, both included
+ *
+ * @param lowAmount Low end of the range
+ * @param highAmount High end of the range
+ */
+unsigned int BinarySearchTree::CountInRange(Cents lowAmount, Cents highAmount) const {
+    return this->countBetween<ByAmount>(lowAmount, highAmount);
 }
 
 /**
- * Traverse the tree amounts in order
+ * Count, total, average and extremes of the amounts of the bids with
+ * ids from lowId to highId, both included
+ *
+ * @param lowId Low end of the range
+ * @param highId High end of the range
  */
-void BinarySearchTree::InAmountOrder() {
-    this->inAmountOrder(amountRoot);
+AmountTotals BinarySearchTree::TotalsInRange(const string& lowId, const string& highId) const {
+    return this->totalsBetween<ByBidId>(IdKey(lowId), IdKey(highId));
 }
 
 /**
- * Insert a bid
- * 
- * @param bid Bid to insert
+ * Count, total, average and extremes of the amounts from lowAmount to
+ * highAmount, both included
+ *
+ * @param lowAmount Low end of the range
+ * @param highAmount High end of the range
  */
-void BinarySearchTree::Insert(Bid bid) {
+AmountTotals BinarySearchTree::TotalsInRange(Cents lowAmount, Cents highAmount) const {
+    return this->totalsBetween<ByAmount>(lowAmount, highAmount);
+}
 
-    if (root == nullptr) {
-        root = new Node(bid);
+/**
+* first bid not less than a bid id, from the frozen arrays
+* 
+* @param key Bid id key to search for
+**/
+BinarySearchTree::BidIterator BinarySearchTree::frozenLowerBound(const IdKey& key) const {
+    if (key.text == nullptr) {
+        size_t slot = eytzingerLowerBound(frozenNumbers, key.number);
+        if (slot != 0) {
+            return frozenNumberBids[slot];
+        }
+        //past every numeric id, so at the first text id if there is one
+        return frozenTextBids.empty() ? this->BidEnd() : frozenTextBids.front();
     }
-    else {
-        this->addBid(root, bid);
+
+    size_t i = std::lower_bound(frozenTexts.begin(), frozenTexts.end(), string_view(key.text, key.number))
+        - frozenTexts.begin();
+    return (i < frozenTexts.size()) ? frozenTextBids[i] : this->BidEnd();
+}
+
+/**
+* first bid of an order in the current backend
+**/
+template <typename Ordering>
+BinarySearchTree::OrderIterator<Ordering> BinarySearchTree::begin() const {
+    if (backend == B_PLUS) {
+        return OrderIterator<Ordering>(this, Ordering::tree(*this).Begin());
     }
+    return OrderIterator<Ordering>(this, Ordering::index(*this).First());
+}
 
-    if (amountRoot == nullptr) {
-        amountRoot = new Node(bid);
+/**
+* position past the last bid of an order
+**/
+template <typename Ordering>
+BinarySearchTree::OrderIterator<Ordering> BinarySearchTree::end() const {
+    if (backend == B_PLUS) {
+        return OrderIterator<Ordering>(this, typename Ordering::Tree::Position());
     }
-    else {
-        this->addAmountNode(amountRoot, bid);
+    return OrderIterator<Ordering>(this, (Node*)nullptr);
+}
+
+/**
+* first bid of an order whose key is not less than key
+* 
+* @param key Bid id key or amount
+**/
+template <typename Ordering, typename K>
+BinarySearchTree::OrderIterator<Ordering> BinarySearchTree::lowerBound(const K& key) const {
+    if (backend == B_PLUS) {
+        return OrderIterator<Ordering>(this, Ordering::tree(*this).LowerBound(key));
     }
+    return OrderIterator<Ordering>(this, Ordering::index(*this).LowerBound(key));
 }
 
 /**
- * Remove a bid
- * 
- * @param bidId Bid id to remove
- */
-void BinarySearchTree::Remove(string bidId) {
-    this->removeNode(root, bidId);
+* first bid of an order whose key is greater than key
+* 
+* @param key Bid id key or amount
+**/
+template <typename Ordering, typename K>
+BinarySearchTree::OrderIterator<Ordering> BinarySearchTree::upperBound(const K& key) const {
+    if (backend == B_PLUS) {
+        return OrderIterator<Ordering>(this, Ordering::tree(*this).UpperBound(key));
+    }
+    return OrderIterator<Ordering>(this, Ordering::index(*this).UpperBound(key));
 }
 
 /**
- * Search for a bid
- * 
- * @param bidId Bid id to search for
- */
-Bid BinarySearchTree::BidSearch(string bidId) {
+* position of an iterator's bid in its order
+* 
+* @param it Bid to look up, or the end of the order
+**/
+template <typename Ordering>
+unsigned int BinarySearchTree::rank(const OrderIterator<Ordering>& it) const {
+    if (it.node == nullptr) {
+        return size;
+    }
+    if (backend == B_PLUS) {
+        //the full key, tie breaker included, has exactly one position
+        return Ordering::tree(*this).CountBelow(it.pos.Value());
+    }
+    return Ordering::Index::Rank(linked(it.node));
+}
 
-    //start searching from the root
-    Node* current = root;
+/**
+* bid at a position of an order
+* 
+* @param index Position counting from 0
+**/
+template <typename Ordering>
+BinarySearchTree::OrderIterator<Ordering> BinarySearchTree::select(unsigned int index) const {
+    if (backend == B_PLUS) {
+        return OrderIterator<Ordering>(this, Ordering::tree(*this).Select(index));
+    }
+    return OrderIterator<Ordering>(this, Ordering::index(*this).Select(index));
+}
 
-    //keep looping downwards until the bottom is reached or the bid is found
-    while (current != nullptr) {
-        //if the current node matches, return it
-        if (current->bid.bidId.compare(bidId) == 0) {
-            return current->bid;
-        }
-        //if the bid is smaller than the current traverse left
-        if (bidId.compare(current->bid.bidId) < 0) {
-            current = current->bidLeft;
-        }
-        else {
-            current = current->bidRight;
-        }
+/**
+* number of bids of an order with keys from low to high
+* 
+* @param low Low end of the range, included
+* @param high High end of the range, included
+**/
+template <typename Ordering, typename K>
+unsigned int BinarySearchTree::countBetween(const K& low, const K& high) const {
+    unsigned int below, upTo;
+    if (backend == B_PLUS) {
+        below = Ordering::tree(*this).CountBelow(low);
+        upTo = Ordering::tree(*this).CountUpTo(high);
+    }
+    else {
+        below = Ordering::index(*this).CountBelow(low);
+        upTo = Ordering::index(*this).CountUpTo(high);
     }
 
-    Bid bid;
-    return bid;
+    //a range given high end first holds nothing
+    return (upTo > below) ? upTo - below : 0;
 }
 
 /**
- * Search for bids within a range of values
- * 
- * @param lowAmount Low amount of range
- * @param highAmount High amount of range
- */
-void BinarySearchTree::AmountSearch(double lowAmount, double highAmount) {
-    //start searching from the root
-    amountSearch(amountRoot, lowAmount, highAmount);
+* amounts of the bids of an order with keys from low to high
+* 
+* @param low Low end of the range, included
+* @param high High end of the range, included
+**/
+template <typename Ordering, typename K>
+AmountTotals BinarySearchTree::totalsBetween(const K& low, const K& high) const {
+    AmountTotals totals = AmountTotals();
+    totals.count = this->countBetween<Ordering>(low, high);
+    if (totals.count == 0) {
+        return totals;
+    }
+
+    AmountSummary summary;
+    if (backend == B_PLUS) {
+        summary = Ordering::tree(*this).SummarizeBetween(low, high);
+    }
+    else {
+        summary = Ordering::index(*this).SummarizeBetween(low, high);
+    }
+    totals.total = summary.total;
+    totals.lowest = summary.lowest;
+    totals.highest = summary.highest;
+
+    //round half away from zero
+    int64_t count = totals.count;
+    int64_t half = (summary.total.value < 0) ? -count / 2 : count / 2;
+    totals.average = Cents((summary.total.value + half) / count);
+    return totals;
 }
 
 /**
- * Add a bid to some node (recursive)
- *
- * @param node Current node in tree
- * @param bid Bid to be added
- */
-void BinarySearchTree::addBid(Node* node, Bid bid) {
+* find the node holding a bid id
+* 
+* @param bidId Bid id to search for
+* @return the matching node or nullptr
+**/
+Node* BinarySearchTree::findBid(const string& bidId) {
 
-    //if the node is larger than the bid, add to the left subtree
-    if (node->bid.bidId.compare(bid.bidId) > 0) {
-        if (node->bidLeft == nullptr) {
-            node->bidLeft = new Node(bid);
-        }
-        else {
-            this->addBid(node->bidLeft, bid);
+    //numeric ids are parsed once here and then compared as integers
+    IdKey key(bidId);
+
+    if (frozen) {
+        Node* node = this->frozenLowerBound(key).node;
+        if (node != nullptr && node->bidKey.compare(key) == 0) {
+            return node;
         }
+        return nullptr;
     }
 
-    //add the right subtree
-    else {
-        if (node->bidRight == nullptr) {
-            node->bidRight = new Node(bid);
-        }
-        else {
-            this->addBid(node->bidRight, bid);
+    if (backend == B_PLUS) {
+        auto pos = bidIndex.LowerBound(key);
+        if (pos.IsValid() && pos.Value().id.compare(key) == 0) {
+            return pos.Value().node;
         }
+        return nullptr;
     }
+
+    return bidTree.Find(key);
 }
 
 /**
-* bid search function
+* the whole bid of a node, decoded from the source if loaded lazily
 * 
-* @param node Current node in tree
- **/
-void BinarySearchTree::inBidOrder(Node* node) {
-    if (node != nullptr) {
-        inBidOrder(node->bidLeft);
-        std::cout << node->bid.bidId << ": "
-            << node->bid.title << "| "
-            << node->bid.amount << "| "
-            << node->bid.fund << endl;
-        inBidOrder(node->bidRight);
+* @param node Node to look at
+* @return the bid, for a lazy node only valid until the next call
+**/
+const Bid& BinarySearchTree::bidOf(Node* node) const {
+    if (node->bid != nullptr) {
+        return *node->bid;
     }
+    source->Decode(node->offset, node->length, decoded);
+    return decoded;
 }
 
 /**
-* amount search function
+* a new node from the backend's pool, numbered after every node before it
 * 
-* @param node Current node in tree
+* @param from Full bid or lazily loaded record the node is made from
 **/
-void BinarySearchTree::inAmountOrder(Node* node) {
-
-    if (node != nullptr) {
-        inAmountOrder(node->amountLeft);
-        std::cout << node->bid.bidId << ": "
-            << node->bid.title << "| "
-            << node->bid.amount << "| "
-            << node->bid.fund << endl;
-        inAmountOrder(node->amountRight);
+template <typename From>
+Node* BinarySearchTree::allocateNode(const From& from) {
+    Node* node;
+    if (backend == B_PLUS) {
+        node = pool.Allocate(from);
     }
+    else {
+        node = linkedPool.Allocate(from);
+    }
+    node->seq = sequence++;
+    return node;
 }
 
 /**
-* add amount node function
+* link freshly allocated nodes into empty indexes, sorting them first
 * 
-* @param node Current node in tree
-* @param bid Bid to be added
+* @param byId Nodes in load order, left sorted by id
 **/
-void BinarySearchTree::addAmountNode(Node* node, Bid bid) {
-    //if a node is larger than the bid, add to the left subtree
-    if (node->bid.amount > bid.amount) {
-        if (node->amountLeft == nullptr) {
-            node->amountLeft = new Node(bid);
+void BinarySearchTree::buildIndexes(vector<Node*>& byId) {
+    vector<Node*> byAmount(byId);
+
+    //both backends order equal keys by sequence, and the nodes come in
+    //numbered in load order, so a stable sort on the key alone gives the
+    //full key order
+    auto amountSort = std::async(std::launch::async, [&byAmount]() {
+        std::stable_sort(byAmount.begin(), byAmount.end(), [](Node* a, Node* b) {
+            return a->amount < b->amount;
+        });
+    });
+    std::stable_sort(byId.begin(), byId.end(), [](Node* a, Node* b) {
+        return a->bidKey < b->bidKey;
+    });
+    amountSort.get();
+
+    if (backend == B_PLUS) {
+        vector<BidKey> idKeys;
+        idKeys.reserve(byId.size());
+        for (Node* node : byId) {
+            idKeys.push_back(BidIdOf()(node));
         }
-        else {
-            this->addAmountNode(node->amountLeft, bid);
+        bidIndex.BulkLoad(idKeys);
+
+        vector<AmountKey> amountKeys;
+        amountKeys.reserve(byAmount.size());
+        for (Node* node : byAmount) {
+            amountKeys.push_back(AmountOf()(node));
         }
+        amountIndex.BulkLoad(amountKeys);
     }
-
-    //add the right subtree
     else {
-        if (node->amountRight == nullptr) {
-            node->amountRight = new Node(bid);
-        }
-        else {
-            this->addAmountNode(node->amountRight, bid);
-        }
+        vector<LinkedNode*> sorted(byId.size());
+        std::transform(byId.begin(), byId.end(), sorted.begin(), linked);
+        bidTree.Build(sorted);
+        std::transform(byAmount.begin(), byAmount.end(), sorted.begin(), linked);
+        amountTree.Build(sorted);
     }
+
+    size = (unsigned int)byId.size();
 }
 
 /**
 * remove node function
 * 
-* @param node Current node in tree
-* @param bidId Bid to be removed
+* @param node Node to be unlinked from both trees and released
 **/
-Node* BinarySearchTree::removeNode(Node* node, string bidId) {
-    //if this node is null then return (avoid crashing)
-    if (node == nullptr) {
-        return node;
+void BinarySearchTree::removeNode(Node* node) {
+    this->thaw();
+    if (backend == B_PLUS) {
+        bidIndex.Remove(BidIdOf()(node));
+        amountIndex.Remove(AmountOf()(node));
     }
-
-    //recurse down the left subtree
-    if (bidId.compare(node->bid.bidId) < 0) {
-        node->bidLeft = removeNode(node->bidLeft, bidId);
+    else {
+        bidTree.Erase(linked(node));
+        amountTree.Erase(linked(node));
+    }
+    if (node->bid != nullptr) {
+        bidPool.Release(node->bid);
     }
-    else if (bidId.compare(node->bid.bidId) > 0) {
-        node->bidRight = removeNode(node->bidRight, bidId);
+    if (backend == B_PLUS) {
+        pool.Release(node);
     }
     else {
-        // no children so this is a leaf node
-        if (node->bidLeft == nullptr && node->bidRight == nullptr) {
-            delete node;
-            node = nullptr;
-        }
-        //one child to the left
-        else if (node->bidLeft != nullptr && node->bidRight == nullptr) {
-            Node* temp = node;
-            node = node->bidRight;
-            delete temp;
-        }
-        //one child to the right
-        else if (node->bidRight != nullptr && node->bidLeft == nullptr) {
-            Node* temp = node;
-            node = node->bidRight;
-            delete temp;
-        }
-        //two children
-        else {
-            Node* temp = node->bidRight;
-            while (temp->bidLeft != nullptr) {
-                temp = temp->bidLeft;
-            }
-            node->bid = temp->bid;
-            node->bidRight = removeNode(node->bidRight, temp->bid.bidId);
-        }
+        linkedPool.Release(linked(node));
     }
-    return node;
+    size--;
+    version++;
 }
 
 /**
-* amount search function
-* 
-* @param node Current node in tree
-* @param lowAmount Lowest amount to be searched
-* @param highAmount Highest amount to be searched
+* drop the frozen arrays, called before every mutation
 **/
-void BinarySearchTree::amountSearch(Node* node, double lowAmount, double highAmount) {
-    if (node != nullptr) {
-        amountSearch(node->amountLeft, lowAmount, highAmount);
-        if (node->bid.amount >= lowAmount && node->bid.amount <= highAmount) {
-            std::cout << node->bid.bidId << ": "
-                << node->bid.title << "| "
-                << node->bid.amount << "| "
-                << node->bid.fund << endl;
-        }
-        amountSearch(node->amountRight, lowAmount, highAmount);
+void BinarySearchTree::thaw() {
+    if (!frozen) {
+        return;
     }
+    frozen = false;
+    vector<uint64_t>().swap(frozenNumbers);
+    vector<string_view>().swap(frozenTexts);
+    vector<BidIterator>().swap(frozenNumberBids);
+    vector<BidIterator>().swap(frozenTextBids);
+    vector<Cents>().swap(frozenAmounts);
+    vector<unsigned int>().swap(frozenRanks);
+    vector<Node*>().swap(frozenAmountNodes);
 }
 
-
 //============================================================================
 // Static methods used for testing
 //============================================================================
@@ -401,62 +1791,361 @@ void BinarySearchTree::amountSearch(Node* node, double lowAmount, double highAmo
  */
 void displayBid(Bid bid) {
     std::cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | "
-        << bid.fund << endl;
+        << fundNames[bid.fund] << '\n';
     return;
 }
 
+// How a condition compares a column with its value
+enum ConditionOp {
+    OP_EQUAL,         // ==
+    OP_NOT_EQUAL,     // !=
+    OP_LESS,          // <
+    OP_LESS_EQUAL,    // <=
+    OP_GREATER,       // >
+    OP_GREATER_EQUAL  // >=
+};
+
+/**
+ * A condition rows must meet to be loaded, such as "Department == ITS"
+ * or "Winning Bid >= $100"
+ *
+ * A value that reads as money compares the column as an amount, any
+ * other value compares the column text with quotes and blanks trimmed
+ */
+struct BidCondition {
+    string column;
+    ConditionOp op; // parsed once, tested for every row
+    string text;
+    bool isAmount;
+    Cents amount;
+};
+
+// field text without the blanks and quotes exports put around it
+static string_view trimField(string_view text) {
+    const char* blanks = " \t\r\"";
+    size_t first = text.find_first_not_of(blanks);
+    if (first == string_view::npos) {
+        return string_view();
+    }
+    return text.substr(first, text.find_last_not_of(blanks) - first + 1);
+}
+
+/**
+ * Parse a condition written as <column> <op> <value>
+ *
+ * @param text Text of the condition
+ * @param condition Filled in when the text parses
+ * @return false when no operator, column or value is found
+ */
+bool parseCondition(const string& text, BidCondition& condition) {
+    // two character operators first, so "<=" is not taken for "<"
+    const struct {
+        const char* text;
+        ConditionOp op;
+    } ops[] = {
+        { "==", OP_EQUAL }, { "!=", OP_NOT_EQUAL }, { "<=", OP_LESS_EQUAL },
+        { ">=", OP_GREATER_EQUAL }, { "<", OP_LESS }, { ">", OP_GREATER },
+    };
+
+    // the first operator character splits the column from the value
+    size_t at = text.find_first_of("=!<>");
+    if (at == string::npos) {
+        return false;
+    }
+    size_t length = 0;
+    for (const auto& op : ops) {
+        if (text.compare(at, strlen(op.text), op.text) == 0) {
+            condition.op = op.op;
+            length = strlen(op.text);
+            break;
+        }
+    }
+    if (length == 0) {
+        return false;
+    }
+
+    condition.column = string(trimField(string_view(text).substr(0, at)));
+    condition.text = string(trimField(string_view(text).substr(at + length)));
+    if (condition.column.empty() || condition.text.empty()) {
+        return false;
+    }
+
+    // money is an optional $ then digits, thousands separators and a point
+    size_t digits = 0;
+    condition.isAmount = true;
+    for (size_t i = 0; i < condition.text.size() && condition.isAmount; i++) {
+        char c = condition.text[i];
+        if (c >= '0' && c <= '9') {
+            digits++;
+        }
+        else if (!(c == '$' && i == 0) && c != ',' && c != '.') {
+            condition.isAmount = false;
+        }
+    }
+    condition.isAmount = condition.isAmount && digits > 0;
+    condition.amount = strToCents(condition.text);
+    return true;
+}
+
+/**
+ * Test one field of a row against a condition
+ *
+ * @param condition Condition to test
+ * @param field Raw text of the condition's column
+ */
+bool conditionHolds(const BidCondition& condition, string_view field) {
+    int order;
+    if (condition.isAmount) {
+        Cents amount = strToCents(field);
+        order = (amount < condition.amount) ? -1 : (amount > condition.amount) ? 1 : 0;
+    }
+    else {
+        order = trimField(field).compare(condition.text);
+    }
+
+    switch (condition.op) {
+    case OP_EQUAL:
+        return order == 0;
+    case OP_NOT_EQUAL:
+        return order != 0;
+    case OP_LESS:
+        return order < 0;
+    case OP_LESS_EQUAL:
+        return order <= 0;
+    case OP_GREATER:
+        return order > 0;
+    default:
+        return order >= 0;
+    }
+}
+
 /**
  * Load a CSV file containing bids into a container
  *
+ * Rows failing any of the conditions are dropped by the reader while
+ * they are still raw fields, before a Bid is built for them
+ *
+ * A lazy load into an empty tree reads only the id and amount of each
+ * row and leaves titles and funds in the file until they are shown
+ *
  * @param csvPath the path to the CSV file to load
+ * @param conditions what every loaded row must meet, may be empty
+ * @param lazy whether to keep the bids in the file
  * @return a container holding all the bids read
  */
-void loadBids(string csvPath, BinarySearchTree* bst) {
+void loadBids(string csvPath, BinarySearchTree* bst, const vector<BidCondition>& conditions, bool lazy) {
     std::cout << "Loading CSV file " << csvPath << endl;
 
-    // initialize the CSV Parser using the given path
-    csv::Parser file = csv::Parser(csvPath);
-
-    // read and display header row - optional
-    vector<string> header = file.getHeader();
-    for (auto const& c : header) {
-        std::cout << c << " | ";
-    }
-    std::cout << "" << endl;
+    // an empty tree is built in one go from the whole file instead
+    bool bulk = bst->Size() == 0;
+    vector<BidRecord> records;
+    BidSource* source = nullptr;
 
     try {
-        // loop to read rows of a CSV file
-        for (unsigned int i = 0; i < file.rowCount(); i++) {
+        // stream the file one record at a time so only the tree stays in
+        // memory, each window of it split into fields on every core
+        csv::Reader file(csvPath, ',', 0);
+
+        // read and display header row - optional
+        for (auto const& c : file.getHeader()) {
+            std::cout << c << " | ";
+        }
+        std::cout << "" << endl;
+
+        // find the column of every mapped field in this file's header
+        size_t columns[bidColumnCount];
+        for (size_t i = 0; i < bidColumnCount; i++) {
+            int found = -1;
+            for (const char* name : bidColumns[i].names) {
+                if (found < 0 && name != nullptr) {
+                    found = file.findColumn(name);
+                }
+            }
+            if (found < 0) {
+                throw csv::Error(string("can't find column ").append(bidColumns[i].names[0]));
+            }
+            columns[i] = (size_t)found;
+        }
+
+        // and the column each condition tests
+        if (!conditions.empty()) {
+            vector<size_t> tested;
+            for (const BidCondition& condition : conditions) {
+                int found = file.findColumn(condition.column);
+                if (found < 0) {
+                    throw csv::Error(string("can't find column ").append(condition.column));
+                }
+                tested.push_back((size_t)found);
+            }
+            file.setFilter([&conditions, tested](const vector<string_view>& fields) {
+                for (size_t i = 0; i < tested.size(); i++) {
+                    if (!conditionHolds(conditions[i], fields[tested[i]])) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
 
-            // Create a data structure and add to the collection of bids
-            Bid bid;
-            bid.bidId = file[i][1];
-            bid.title = file[i][0];
-            bid.fund = file[i][8];
-            bid.amount = strToDouble(file[i][4], '$');
+        // the records stay in the mapped file, which the tree then owns
+        if (lazy && bulk) {
+            source = new BidSource(csvPath, columns);
+        }
 
-            // push this bid to the end
-            bst->Insert(bid);
+        // loop to read rows of a CSV file
+        vector<string_view> row;
+        if (source != nullptr) {
+            while (file.next(row)) {
+                BidRecord record;
+                string_view id = row[columns[ID_COLUMN]];
+                record.bidKey = IdKey(id);
+                if (record.bidKey.text != nullptr) {
+                    // the row is gone after the next read, the mapping is not
+                    record.bidKey = IdKey(string_view(source->Data() + file.offsetOf(id), id.size()));
+                }
+                record.amount = strToCents(row[columns[AMOUNT_COLUMN]]);
+                record.offset = file.offsetOf(row.front());
+                record.length = (uint32_t)(row.back().data() + row.back().size() - row.front().data());
+                records.push_back(record);
+            }
+        }
+        else if (bulk) {
+            // each bid goes straight into the tree, which links them all
+            // at the end, and keeps the rows read before any error
+            bst->BulkLoad([&file, &row, &columns](Bid& bid) {
+                if (!file.next(row)) {
+                    return false;
+                }
+                for (size_t i = 0; i < bidColumnCount; i++) {
+                    bidColumns[i].store(bid, row[columns[i]]);
+                }
+                return true;
+            });
+        }
+        else {
+            while (file.next(row)) {
+                // Create a data structure and add it to the tree
+                Bid bid;
+                for (size_t i = 0; i < bidColumnCount; i++) {
+                    bidColumns[i].store(bid, row[columns[i]]);
+                }
+                bst->Insert(std::move(bid));
+            }
         }
     }
     catch (csv::Error& e) {
         std::cerr << e.what() << std::endl;
     }
+
+    // keep the rows read before any error, as the insert path does
+    if (source != nullptr) {
+        bst->BulkLoad(source, records);
+    }
+}
+
+/**
+ * Parse a money amount such as "$1,234.56" into cents without copying
+ *
+ * Dollar signs, thousands separators, quotes and blanks are skipped, a
+ * third decimal rounds the cents half up, and like atof the parse stops
+ * at the first other character. Amounts past INT64_MAX / 1000 dollars
+ * saturate there, leaving room to add a few of them up in cents
+ *
+ * @param str Text of the amount
+ */
+Cents strToCents(string_view str) {
+    const int64_t maxWhole = INT64_MAX / 1000;
+    int64_t whole = 0;
+    int64_t fraction = 0;
+    int fractionDigits = 0;
+    bool point = false;
+    bool digits = false;
+    bool negative = false;
+    bool saturated = false;
+
+    for (char c : str) {
+        if (c >= '0' && c <= '9') {
+            digits = true;
+            if (!point) {
+                //whole is at most maxWhole here, so this cannot overflow
+                whole = whole * 10 + (c - '0');
+                if (whole > maxWhole) {
+                    whole = maxWhole;
+                    saturated = true;
+                }
+            }
+            else if (fractionDigits < 2) {
+                fraction = fraction * 10 + (c - '0');
+                fractionDigits++;
+            }
+            else if (fractionDigits == 2) {
+                fraction += (c >= '5') ? 1 : 0;
+                fractionDigits++;
+            }
+        }
+        else if (c == '.' && !point) {
+            point = true;
+        }
+        else if (c == '-' && !digits && !negative) {
+            negative = true;
+        }
+        else if (c != '$' && c != ',' && c != '"' && c != ' ' && c != '\t') {
+            break;
+        }
+    }
+    if (fractionDigits == 1) {
+        fraction *= 10;
+    }
+    if (saturated) {
+        fraction = 0;
+    }
+
+    int64_t cents = whole * 100 + fraction;
+    return Cents(negative ? -cents : cents);
 }
 
 /**
- * Simple C function to convert a string to a double
- * after stripping out unwanted char
+ * Format cents the way a double amount used to print: 225.46, 12.5, 100
  *
- * credit: http://stackoverflow.com/a/24875936
+ * @param first Where to write, with room for at least 24 characters
+ * @param last End of the room
+ * @param amount Amount to format
+ * @return one past the last character written
+ */
+char* centsToChars(char* first, char* last, Cents amount) {
+    //negated unsigned, since -INT64_MIN does not fit an int64_t
+    uint64_t value = (uint64_t)amount.value;
+    if (amount.value < 0) {
+        *first++ = '-';
+        value = 0 - value;
+    }
+    first = std::to_chars(first, last, value / 100).ptr;
+
+    uint64_t rest = value % 100;
+    if (rest != 0) {
+        *first++ = '.';
+        *first++ = (char)('0' + rest / 10);
+        if (rest % 10 != 0) {
+            *first++ = (char)('0' + rest % 10);
+        }
+    }
+    return first;
+}
+
+/**
+ * Print cents as centsToChars formats them
  *
- * @param ch The character to strip out
+ * @param out Stream to print to
+ * @param amount Amount to print
  */
-double strToDouble(string str, char ch) {
-    str.erase(remove(str.begin(), str.end(), ch), str.end());
-    return atof(str.c_str());
+ostream& operator<<(ostream& out, Cents amount) {
+    char text[24];
+    return out.write(text, centsToChars(text, text + sizeof(text), amount) - text);
 }
 
+// the tests build this file into their own program, with their own main()
+#ifndef BINARYSEARCHTREE_NO_MAIN
+
 /**
  * The one and only main() method
  */
@@ -464,28 +2153,53 @@ int main(int argc, char* argv[]) {
 
     // process command line arguments
     string csvPath, bidKey;
-    double amountLow, amountHigh;
-
-    switch (argc) {
-    case 2:
+    string amountText;
+    Cents amountLow, amountHigh;
+    AmountTotals totals;
+    TreeBackend backend = RED_BLACK;
+    vector<BidCondition> conditions;
+    bool lazy = false;
+
+    if (argc >= 2) {
         csvPath = argv[1];
-        break;
-    case 3:
-        csvPath = argv[1];
-        break;
-    default:
+    }
+    else {
         csvPath = "eBid_Monthly_Sales_Dec_2016.csv";
     }
 
+    // optional further arguments: bplus picks the B+ tree indexes, lazy
+    // leaves titles and funds in the file, and conditions such as
+    // "Winning Bid >= 100" restrict what is loaded
+    for (int i = 2; i < argc; i++) {
+        BidCondition condition;
+        if (string(argv[i]) == "bplus") {
+            backend = B_PLUS;
+        }
+        else if (string(argv[i]) == "lazy") {
+            lazy = true;
+        }
+        else if (parseCondition(argv[i], condition)) {
+            conditions.push_back(condition);
+        }
+        else {
+            std::cerr << "Invalid condition: " << argv[i] << endl;
+            return 1;
+        }
+    }
+
     // Define a timer variable
     clock_t ticks;
 
     // Define a binary search tree to hold all bids
     BinarySearchTree* bst;
-    bst = new BinarySearchTree(); //create a new binary search tree
+    bst = new BinarySearchTree(backend); //create a new binary search tree
 
     Bid bid;
 
+    // listings are rendered through one buffered writer, flushed after each
+    BidWriter writer(std::cout);
+    BidVisitor print = [&writer](const Bid& listed) { writer.Write(listed); };
+
     int choice = 0;
     while (choice != 9) {
         std::cout << "Menu:" << endl;
@@ -494,6 +2208,9 @@ int main(int argc, char* argv[]) {
         std::cout << "  3. Find Bid" << endl;
         std::cout << "  4. Find Bid by Amount" << endl;
         std::cout << "  5. Remove Bid" << endl;
+        std::cout << "  6. Total Bids by Amount" << endl;
+        std::cout << "  7. Rank Bid by Amount" << endl;
+        std::cout << "  8. Find Bid at Percentile" << endl;
         std::cout << "  9. Exit" << endl;
         std::cout << "Enter choice: ";
 
@@ -519,8 +2236,14 @@ int main(int argc, char* argv[]) {
             // Initialize a timer variable before loading bids
             ticks = clock();
 
+            // Drop the bids of an earlier load so reloading does not duplicate them
+            bst->Clear();
+
             // Complete the method call to load the bids
-            loadBids(csvPath, bst);
+            loadBids(csvPath, bst, conditions, lazy);
+
+            // Sessions mostly search after loading, so compact the indexes
+            bst->Freeze();
 
             // Calculate elapsed time and display the result
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
@@ -532,7 +2255,8 @@ int main(int argc, char* argv[]) {
 
         case 2:
             // Display the entire bid collection
-            bst->InBidOrder();
+            bst->InBidOrder(print);
+            writer.Flush();
             break;
 
         case 3:
@@ -560,22 +2284,75 @@ int main(int argc, char* argv[]) {
         case 4:
             // Find bids by the amount
             std::cout << "Enter low amount: "; //prompt user for low amount
-            cin >> amountLow; //store low amount in amountLow
+            cin >> amountText; //store low amount in amountLow
+            amountLow = strToCents(amountText);
             std::cout << "Enter high amount: "; //prompt user for high amount
-            cin >> amountHigh; //store high amount in amountHigh
-            bst->AmountSearch(amountLow, amountHigh);
+            cin >> amountText; //store high amount in amountHigh
+            amountHigh = strToCents(amountText);
+            bst->AmountSearch(amountLow, amountHigh, print);
+            writer.Flush();
             break;
 
         case 5:
             // Remove a bid
             std::cout << "Enter bid id: "; //prompt user for bid id
             cin >> bidKey; //store bid id in bidKey
-            bst->Remove(bidKey);
+            if (bst->Remove(bidKey)) {
+                std::cout << "Bid Id " << bidKey << " removed." << endl;
+            }
+            else {
+                std::cout << "Bid Id " << bidKey << " not found." << endl;
+            }
+            break;
+
+        case 6:
+            // Total up bids by the amount, without listing them
+            std::cout << "Enter low amount: ";
+            cin >> amountText;
+            amountLow = strToCents(amountText);
+            std::cout << "Enter high amount: ";
+            cin >> amountText;
+            amountHigh = strToCents(amountText);
+            totals = bst->TotalsInRange(amountLow, amountHigh);
+            std::cout << totals.count << " bids from " << amountLow << " to " << amountHigh
+                << " | total " << totals.total << " | average " << totals.average
+                << " | highest " << totals.highest << endl;
+            break;
+
+        case 7:
+            // Where a bid stands among all winning amounts
+            std::cout << "Enter bid id: ";
+            cin >> bidKey;
+            bid = bst->BidSearch(bidKey);
+            if (!bid.bidId.empty()) {
+                std::cout << "Bid Id " << bidKey << " won for more than "
+                    << bst->Rank(bst->AmountLowerBound(bid.amount)) << " of " << bst->Size()
+                    << " bids" << endl;
+            }
+            else {
+                std::cout << "Bid Id " << bidKey << " not found." << endl;
+            }
+            break;
+
+        case 8:
+            // Find the bid at a percentile of the amounts, 50 for the median
+            std::cout << "Enter percentile: ";
+            cin >> amountText;
+            if (bst->Size() > 0) {
+                double percentile = std::min(std::max(std::atof(amountText.c_str()), 0.0), 100.0);
+                unsigned int index = (unsigned int)(percentile / 100.0 * (bst->Size() - 1) + 0.5);
+                displayBid(*bst->AmountSelect(index));
+            }
             break;
         }
     }
 
+    // release every bid before exiting
+    delete bst;
+
     std::cout << "Good bye." << endl;
 
     return 0;
 }
+
+#endif /*!BINARYSEARCHTREE_NO_MAIN*/
@@ -0,0 +1,920 @@
+//============================================================================
+// Name        : OrderedIndex.hpp
+// Author      : John Austin
+// Version     : 1.0
+// Copyright   : Copyright © 2017 SNHU COCE
+// Description : Generic intrusive red-black index and Eytzinger helpers
+//============================================================================
+
+#ifndef     _ORDEREDINDEX_HPP_
+# define    _ORDEREDINDEX_HPP_
+
+# include <cstddef>
+# include <functional>
+# include <vector>
+
+# if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <xmmintrin.h>
+#  define ORDEREDINDEX_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+# elif defined(__GNUC__)
+#  define ORDEREDINDEX_PREFETCH(address) __builtin_prefetch(address)
+# else
+#  define ORDEREDINDEX_PREFETCH(address) ((void)(address))
+# endif
+
+/**
+ * Links one element into one OrderedIndex
+ *
+ * An element type carries one hook per index it can be part of, so the
+ * same element sits in several orderings without any extra allocation
+ */
+template <typename Value>
+struct IndexHook {
+    Value* parent;
+    Value* left;
+    Value* right;
+    bool red; // red-black color of the element in this index
+    unsigned int weight; // elements in the subtree rooted here
+
+    IndexHook() {
+        parent = nullptr;
+        left = nullptr;
+        right = nullptr;
+        red = true;
+        weight = 1;
+    }
+};
+
+/**
+ * Summarize policy of an index that keeps no summary of its subtrees
+ *
+ * A policy names a Summary type, empty when default constructed and
+ * combined with +=, which must give the same result in any order. It
+ * gives the summary of one element on its own, and reads and writes
+ * the summary the index keeps for the subtree under an element.
+ */
+struct NoSummary {
+    struct Summary {
+        Summary& operator+=(const Summary&) { return *this; }
+    };
+
+    template <typename Value> Summary Element(const Value*) const { return Summary(); }
+    template <typename Value> Summary Subtree(const Value*) const { return Summary(); }
+    template <typename Value> void SetSubtree(Value*, const Summary&) const {}
+};
+
+/**
+ * Ordered index over elements it does not own, kept as a red-black tree
+ *
+ * Hook names the IndexHook member that links an element into this
+ * index, KeyOf returns an element's key and Compare orders keys. Equal
+ * keys are kept in insertion order. Lookups are templated on the key
+ * type, so with a transparent Compare such as std::less<> a query can
+ * be any type Compare accepts against the stored key.
+ *
+ * Every element also counts the elements in its subtree, so positions
+ * in the order (rank, select and counts of a key range) are found in
+ * O(log n) without visiting the elements in between. A Summarize
+ * policy other than NoSummary likewise keeps an aggregate of each
+ * subtree, so the aggregate of a key range takes O(log n) as well.
+ *
+ * The elements are allocated and freed by the owner, typically from a
+ * pool shared by every index over them; the index only links them.
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare = std::less<>,
+    typename Summarize = NoSummary>
+class OrderedIndex {
+
+public:
+    typedef typename Summarize::Summary Summary;
+
+private:
+    Value* root;
+    unsigned int size;
+    KeyOf keyOf;
+    Compare compare;
+    Summarize summarize;
+
+    static Value*& parent(Value* value) { return (value->*Hook).parent; }
+    static Value*& left(Value* value) { return (value->*Hook).left; }
+    static Value*& right(Value* value) { return (value->*Hook).right; }
+    static bool& red(Value* value) { return (value->*Hook).red; }
+    static unsigned int& weight(Value* value) { return (value->*Hook).weight; }
+    static unsigned int weightOf(Value* value) { return (value != nullptr) ? weight(value) : 0; }
+
+    void resummarize(Value* node);
+    void rotateLeft(Value* node);
+    void rotateRight(Value* node);
+    void replaceNode(Value* node, Value* child);
+    void insertFixup(Value* node);
+    void removeFixup(Value* node, Value* parent);
+
+public:
+    OrderedIndex();
+    unsigned int Size() const;
+    void Clear();
+    template <typename Disposer> void ClearAndDispose(Disposer dispose);
+    void Build(const std::vector<Value*>& sorted);
+    void Insert(Value* added);
+    void Erase(Value* node);
+    template <typename K> Value* Find(const K& key) const;
+    template <typename K> Value* LowerBound(const K& key) const;
+    template <typename K> Value* UpperBound(const K& key) const;
+    Value* First() const;
+    Value* Last() const;
+    static Value* Next(Value* node);
+    static Value* Prev(Value* node);
+    template <typename K> unsigned int CountBelow(const K& key) const;
+    template <typename K> unsigned int CountUpTo(const K& key) const;
+    static unsigned int Rank(Value* node);
+    Value* Select(unsigned int index) const;
+    template <typename K> Summary SummarizeBetween(const K& low, const K& high) const;
+};
+
+/**
+ * Sorted rank held by each slot of an Eytzinger array
+ *
+ * Slot k has its children at 2k and 2k + 1, so a search walks the array
+ * front to back and the next few levels share a handful of cache lines
+ *
+ * @param ranks Filled with count + 1 slots, slot 0 unused
+ * @param count Number of sorted values to lay out
+ */
+inline void eytzingerOrder(std::vector<unsigned int>& ranks, size_t count) {
+    ranks.assign(count + 1, 0);
+
+    //visit the implicit tree in order without recursion: start at the
+    //leftmost slot, then step to the in-order successor each time
+    size_t k = 1;
+    while (2 * k <= count) {
+        k *= 2;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        ranks[k] = i;
+        if (2 * k + 1 <= count) {
+            k = 2 * k + 1;
+            while (2 * k <= count) {
+                k *= 2;
+            }
+        }
+        else {
+            //climb past the right turns, then once more past the left one
+            while (k & 1) {
+                k >>= 1;
+            }
+            k >>= 1;
+        }
+    }
+}
+
+/**
+ * Branchless lower bound in an Eytzinger array
+ *
+ * @param layout Array laid out by eytzingerOrder
+ * @param key Value to search for
+ * @return slot of the first value not less than key, 0 if there is none
+ */
+template <typename T>
+size_t eytzingerLowerBound(const std::vector<T>& layout, const T& key) {
+    //descendants a cache line's worth of slots ahead, fetched early
+    const size_t lookahead = (64 / sizeof(T) > 1) ? 64 / sizeof(T) : 1;
+    size_t count = layout.size();
+    size_t k = 1;
+    while (k < count) {
+        if (k * lookahead < count) {
+            ORDEREDINDEX_PREFETCH(&layout[k * lookahead]);
+        }
+        k = 2 * k + (layout[k] < key);
+    }
+
+    //undo the right turns taken after the last left one
+    while (k & 1) {
+        k >>= 1;
+    }
+    return k >> 1;
+}
+
+/**
+ * Default constructor
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::OrderedIndex() {
+    root = nullptr;
+    size = 0;
+}
+
+/**
+ * Number of elements in the index
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+unsigned int OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Size() const {
+    return size;
+}
+
+/**
+ * Forget every element without touching them
+ *
+ * For when the elements are freed through another index or in bulk
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Clear() {
+    root = nullptr;
+    size = 0;
+}
+
+/**
+ * Unlink every element and hand each one to dispose, without recursion
+ *
+ * @param dispose Called once per element after it has been unlinked
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+template <typename Disposer>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::ClearAndDispose(Disposer dispose) {
+    //post-order walk: go down to a leaf, cut it off its parent, then
+    //continue from the parent so the stack never grows with the height
+    Value* node = root;
+    while (node != nullptr) {
+        if (left(node) != nullptr) {
+            node = left(node);
+        }
+        else if (right(node) != nullptr) {
+            node = right(node);
+        }
+        else {
+            Value* up = parent(node);
+            if (up != nullptr) {
+                if (left(up) == node) {
+                    left(up) = nullptr;
+                }
+                else {
+                    right(up) = nullptr;
+                }
+            }
+            dispose(node);
+            node = up;
+        }
+    }
+    root = nullptr;
+    size = 0;
+}
+
+/**
+ * Replace the contents with elements already in key order, in O(n)
+ *
+ * The elements take the shape of a complete binary tree: slot k of the
+ * Eytzinger order has its children at 2k and 2k + 1, so every link is
+ * known up front and the tree is wired bottom-up in one pass. Only the
+ * last level can be partly filled, so colouring it red and everything
+ * above it black gives every path the same black height.
+ *
+ * @param sorted Elements in ascending key order
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Build(const std::vector<Value*>& sorted) {
+    std::vector<unsigned int> ranks;
+    size_t count = sorted.size();
+    eytzingerOrder(ranks, count);
+
+    size_t lastLevel = 1; // first slot of the deepest level
+    while (2 * lastLevel <= count) {
+        lastLevel *= 2;
+    }
+
+    for (size_t k = count; k >= 1; k--) {
+        Value* node = sorted[ranks[k]];
+        parent(node) = (k > 1) ? sorted[ranks[k / 2]] : nullptr;
+        left(node) = (2 * k <= count) ? sorted[ranks[2 * k]] : nullptr;
+        right(node) = (2 * k + 1 <= count) ? sorted[ranks[2 * k + 1]] : nullptr;
+        red(node) = (k >= lastLevel && k > 1);
+
+        //slots run backwards, so both children are already counted
+        weight(node) = 1 + weightOf(left(node)) + weightOf(right(node));
+        this->resummarize(node);
+    }
+    root = (count > 0) ? sorted[ranks[1]] : nullptr;
+    size = (unsigned int)count;
+}
+
+/**
+ * Link a new element in and rebalance
+ *
+ * @param added Element that is not yet in this index
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Insert(Value* added) {
+
+    //walk down to the leaf position, equal keys go to the right; every
+    //element passed gains one in its subtree
+    Value* up = nullptr;
+    Value* node = root;
+    while (node != nullptr) {
+        up = node;
+        weight(node)++;
+        if (compare(keyOf(added), keyOf(node))) {
+            node = left(node);
+        }
+        else {
+            node = right(node);
+        }
+    }
+
+    //attach the new red element under the parent found above
+    parent(added) = up;
+    left(added) = nullptr;
+    right(added) = nullptr;
+    red(added) = true;
+    weight(added) = 1;
+    if (up == nullptr) {
+        root = added;
+    }
+    else if (compare(keyOf(added), keyOf(up))) {
+        left(up) = added;
+    }
+    else {
+        right(up) = added;
+    }
+    for (Value* node = added; node != nullptr; node = parent(node)) {
+        this->resummarize(node);
+    }
+
+    this->insertFixup(added);
+    size++;
+}
+
+/**
+ * Splice an element out and rebalance, without freeing it
+ *
+ * @param node Element currently in this index
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Erase(Value* node) {
+    Value* child;
+    Value* childParent;
+    bool removedRed = red(node);
+
+    //every element above the place the splice happens loses one
+    Value* spliced = node;
+    if (left(node) != nullptr && right(node) != nullptr) {
+        spliced = right(node);
+        while (left(spliced) != nullptr) {
+            spliced = left(spliced);
+        }
+    }
+    for (Value* up = parent(spliced); up != nullptr; up = parent(up)) {
+        weight(up)--;
+    }
+
+    //at most one child, so splice the element out directly
+    if (left(node) == nullptr) {
+        child = right(node);
+        childParent = parent(node);
+        this->replaceNode(node, child);
+    }
+    else if (right(node) == nullptr) {
+        child = left(node);
+        childParent = parent(node);
+        this->replaceNode(node, child);
+    }
+    //two children, so move the in-order successor into its place
+    else {
+        Value* successor = spliced;
+        removedRed = red(successor);
+        child = right(successor);
+
+        if (parent(successor) == node) {
+            childParent = successor;
+        }
+        else {
+            childParent = parent(successor);
+            this->replaceNode(successor, right(successor));
+            right(successor) = right(node);
+            parent(right(successor)) = successor;
+        }
+        this->replaceNode(node, successor);
+        left(successor) = left(node);
+        parent(left(successor)) = successor;
+        red(successor) = red(node);
+        weight(successor) = weight(node);
+    }
+
+    //the subtrees that lost the element, or gained the successor, all
+    //lie on the path up from where the splice happened
+    for (Value* up = childParent; up != nullptr; up = parent(up)) {
+        this->resummarize(up);
+    }
+
+    //removing a black element shortens one path, so restore the black height
+    if (!removedRed) {
+        this->removeFixup(child, childParent);
+    }
+    size--;
+}
+
+/**
+ * First element whose key is equivalent to key
+ *
+ * @param key Stored key or any type Compare accepts against it
+ * @return the element or nullptr
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+template <typename K>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Find(const K& key) const {
+    Value* found = this->LowerBound(key);
+    if (found != nullptr && !compare(key, keyOf(found))) {
+        return found;
+    }
+    return nullptr;
+}
+
+/**
+ * First element whose key is not less than key
+ *
+ * @param key Stored key or any type Compare accepts against it
+ * @return the element or nullptr
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+template <typename K>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::LowerBound(const K& key) const {
+    //equal keys can sit on either side, so keep going left on a match
+    Value* found = nullptr;
+    Value* node = root;
+    while (node != nullptr) {
+        if (compare(keyOf(node), key)) {
+            node = right(node);
+        }
+        else {
+            found = node;
+            node = left(node);
+        }
+    }
+    return found;
+}
+
+/**
+ * First element whose key is greater than key
+ *
+ * @param key Stored key or any type Compare accepts against it
+ * @return the element or nullptr
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+template <typename K>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::UpperBound(const K& key) const {
+    //equal keys can sit on either side, so keep going right on a match
+    Value* found = nullptr;
+    Value* node = root;
+    while (node != nullptr) {
+        if (compare(key, keyOf(node))) {
+            found = node;
+            node = left(node);
+        }
+        else {
+            node = right(node);
+        }
+    }
+    return found;
+}
+
+/**
+ * Element with the smallest key
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::First() const {
+    Value* node = root;
+    if (node != nullptr) {
+        while (left(node) != nullptr) {
+            node = left(node);
+        }
+    }
+    return node;
+}
+
+/**
+ * Element with the largest key
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Last() const {
+    Value* node = root;
+    if (node != nullptr) {
+        while (right(node) != nullptr) {
+            node = right(node);
+        }
+    }
+    return node;
+}
+
+/**
+ * In-order successor, found through the parent links
+ *
+ * @param node Current element
+ * @return the next element in order, or nullptr after the last one
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Next(Value* node) {
+    //smallest element of the right subtree
+    if (right(node) != nullptr) {
+        node = right(node);
+        while (left(node) != nullptr) {
+            node = left(node);
+        }
+        return node;
+    }
+
+    //otherwise climb until we arrive from a left child
+    Value* up = parent(node);
+    while (up != nullptr && node == right(up)) {
+        node = up;
+        up = parent(node);
+    }
+    return up;
+}
+
+/**
+ * In-order predecessor, the mirror image of Next
+ *
+ * @param node Current element
+ * @return the previous element in order, or nullptr before the first one
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Prev(Value* node) {
+    //largest element of the left subtree
+    if (left(node) != nullptr) {
+        node = left(node);
+        while (right(node) != nullptr) {
+            node = right(node);
+        }
+        return node;
+    }
+
+    //otherwise climb until we arrive from a right child
+    Value* up = parent(node);
+    while (up != nullptr && node == left(up)) {
+        node = up;
+        up = parent(node);
+    }
+    return up;
+}
+
+/**
+ * Number of elements whose key is less than key
+ *
+ * @param key Stored key or any type Compare accepts against it
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+template <typename K>
+unsigned int OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::CountBelow(const K& key) const {
+    //the same walk as LowerBound, counting each left subtree left behind
+    unsigned int below = 0;
+    Value* node = root;
+    while (node != nullptr) {
+        if (compare(keyOf(node), key)) {
+            below += weightOf(left(node)) + 1;
+            node = right(node);
+        }
+        else {
+            node = left(node);
+        }
+    }
+    return below;
+}
+
+/**
+ * Number of elements whose key is not greater than key
+ *
+ * @param key Stored key or any type Compare accepts against it
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+template <typename K>
+unsigned int OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::CountUpTo(const K& key) const {
+    unsigned int upTo = 0;
+    Value* node = root;
+    while (node != nullptr) {
+        if (compare(key, keyOf(node))) {
+            node = left(node);
+        }
+        else {
+            upTo += weightOf(left(node)) + 1;
+            node = right(node);
+        }
+    }
+    return upTo;
+}
+
+/**
+ * Position of an element in the order, counting from 0
+ *
+ * @param node Element currently in this index
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+unsigned int OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Rank(Value* node) {
+    //everything in the left subtree, plus each ancestor reached from
+    //its right side along with that ancestor's own left subtree
+    unsigned int rank = weightOf(left(node));
+    for (Value* up = parent(node); up != nullptr; node = up, up = parent(up)) {
+        if (node == right(up)) {
+            rank += weightOf(left(up)) + 1;
+        }
+    }
+    return rank;
+}
+
+/**
+ * Element at a position in the order, counting from 0
+ *
+ * @param index Position of the element
+ * @return the element, or nullptr when index is not below Size()
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+Value* OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Select(unsigned int index) const {
+    Value* node = root;
+    while (node != nullptr) {
+        unsigned int before = weightOf(left(node));
+        if (index < before) {
+            node = left(node);
+        }
+        else if (index == before) {
+            return node;
+        }
+        else {
+            index -= before + 1;
+            node = right(node);
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Summary of the elements whose keys lie from low to high, both included
+ *
+ * @param low Low end of the range
+ * @param high High end of the range
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+template <typename K>
+typename OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::Summary
+OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::SummarizeBetween(const K& low, const K& high) const {
+    //find the topmost element in range, where the paths to the two
+    //ends of the range part
+    Summary total;
+    Value* split = root;
+    while (split != nullptr) {
+        if (compare(keyOf(split), low)) {
+            split = right(split);
+        }
+        else if (compare(high, keyOf(split))) {
+            split = left(split);
+        }
+        else {
+            break;
+        }
+    }
+    if (split == nullptr) {
+        return total;
+    }
+    total += summarize.Element(split);
+
+    //towards low, every element not below it brings its right subtree
+    for (Value* node = left(split); node != nullptr;) {
+        if (compare(keyOf(node), low)) {
+            node = right(node);
+        }
+        else {
+            total += summarize.Element(node);
+            if (right(node) != nullptr) {
+                total += summarize.Subtree(right(node));
+            }
+            node = left(node);
+        }
+    }
+
+    //and the mirror image towards high
+    for (Value* node = right(split); node != nullptr;) {
+        if (compare(high, keyOf(node))) {
+            node = left(node);
+        }
+        else {
+            total += summarize.Element(node);
+            if (left(node) != nullptr) {
+                total += summarize.Subtree(left(node));
+            }
+            node = right(node);
+        }
+    }
+    return total;
+}
+
+/**
+ * Rotate an element down to the left
+ *
+ * @param node Element whose right child takes its place
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::rotateLeft(Value* node) {
+    Value* pivot = right(node);
+    right(node) = left(pivot);
+    if (left(pivot) != nullptr) {
+        parent(left(pivot)) = node;
+    }
+    this->replaceNode(node, pivot);
+    left(pivot) = node;
+    parent(node) = pivot;
+
+    //the pivot now spans what node did, node lost the pivot's right side
+    weight(pivot) = weight(node);
+    weight(node) = 1 + weightOf(left(node)) + weightOf(right(node));
+    summarize.SetSubtree(pivot, summarize.Subtree(node));
+    this->resummarize(node);
+}
+
+/**
+ * Rotate an element down to the right
+ *
+ * @param node Element whose left child takes its place
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::rotateRight(Value* node) {
+    Value* pivot = left(node);
+    left(node) = right(pivot);
+    if (right(pivot) != nullptr) {
+        parent(right(pivot)) = node;
+    }
+    this->replaceNode(node, pivot);
+    right(pivot) = node;
+    parent(node) = pivot;
+
+    weight(pivot) = weight(node);
+    weight(node) = 1 + weightOf(left(node)) + weightOf(right(node));
+    summarize.SetSubtree(pivot, summarize.Subtree(node));
+    this->resummarize(node);
+}
+
+/**
+ * Recompute the summary of an element's subtree from its children
+ *
+ * @param node Element whose children are already summarized
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::resummarize(Value* node) {
+    Summary subtree = summarize.Element(node);
+    if (left(node) != nullptr) {
+        subtree += summarize.Subtree(left(node));
+    }
+    if (right(node) != nullptr) {
+        subtree += summarize.Subtree(right(node));
+    }
+    summarize.SetSubtree(node, subtree);
+}
+
+/**
+ * Hang a child where an element used to be
+ *
+ * @param node Element being replaced
+ * @param child Element (or nullptr) taking its place under the parent
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::replaceNode(Value* node, Value* child) {
+    Value* up = parent(node);
+    if (up == nullptr) {
+        root = child;
+    }
+    else if (left(up) == node) {
+        left(up) = child;
+    }
+    else {
+        right(up) = child;
+    }
+    if (child != nullptr) {
+        parent(child) = up;
+    }
+}
+
+/**
+ * Restore the red-black rules after inserting a red element
+ *
+ * @param node Element that was just inserted
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::insertFixup(Value* node) {
+    //only a red parent breaks the rules
+    while (parent(node) != nullptr && red(parent(node))) {
+        Value* up = parent(node);
+        Value* grandparent = parent(up);
+
+        if (up == left(grandparent)) {
+            Value* uncle = right(grandparent);
+            //red uncle, push the blackness down from the grandparent
+            if (uncle != nullptr && red(uncle)) {
+                red(up) = false;
+                red(uncle) = false;
+                red(grandparent) = true;
+                node = grandparent;
+            }
+            //black uncle, rotate the grandparent over
+            else {
+                if (node == right(up)) {
+                    this->rotateLeft(up);
+                    node = up;
+                    up = parent(node);
+                }
+                red(up) = false;
+                red(grandparent) = true;
+                this->rotateRight(grandparent);
+            }
+        }
+        else {
+            Value* uncle = left(grandparent);
+            if (uncle != nullptr && red(uncle)) {
+                red(up) = false;
+                red(uncle) = false;
+                red(grandparent) = true;
+                node = grandparent;
+            }
+            else {
+                if (node == left(up)) {
+                    this->rotateRight(up);
+                    node = up;
+                    up = parent(node);
+                }
+                red(up) = false;
+                red(grandparent) = true;
+                this->rotateLeft(grandparent);
+            }
+        }
+    }
+    red(root) = false;
+}
+
+/**
+ * Restore the red-black rules after removing a black element
+ *
+ * @param node Element (or nullptr) that carries the extra black
+ * @param up Parent of that element
+ */
+template <typename Value, IndexHook<Value> Value::*Hook, typename KeyOf, typename Compare, typename Summarize>
+void OrderedIndex<Value, Hook, KeyOf, Compare, Summarize>::removeFixup(Value* node, Value* up) {
+    while (node != root && (node == nullptr || !red(node))) {
+        if (node == left(up)) {
+            Value* sibling = right(up);
+            //red sibling, rotate so the sibling is black
+            if (red(sibling)) {
+                red(sibling) = false;
+                red(up) = true;
+                this->rotateLeft(up);
+                sibling = right(up);
+            }
+            //sibling with black children, move the extra black up
+            if ((left(sibling) == nullptr || !red(left(sibling)))
+                && (right(sibling) == nullptr || !red(right(sibling)))) {
+                red(sibling) = true;
+                node = up;
+                up = parent(node);
+            }
+            //sibling with a red child, rotate it over and finish
+            else {
+                if (right(sibling) == nullptr || !red(right(sibling))) {
+                    red(left(sibling)) = false;
+                    red(sibling) = true;
+                    this->rotateRight(sibling);
+                    sibling = right(up);
+                }
+                red(sibling) = red(up);
+                red(up) = false;
+                red(right(sibling)) = false;
+                this->rotateLeft(up);
+                node = root;
+            }
+        }
+        else {
+            Value* sibling = left(up);
+            if (red(sibling)) {
+                red(sibling) = false;
+                red(up) = true;
+                this->rotateRight(up);
+                sibling = left(up);
+            }
+            if ((left(sibling) == nullptr || !red(left(sibling)))
+                && (right(sibling) == nullptr || !red(right(sibling)))) {
+                red(sibling) = true;
+                node = up;
+                up = parent(node);
+            }
+            else {
+                if (left(sibling) == nullptr || !red(left(sibling))) {
+                    red(right(sibling)) = false;
+                    red(sibling) = true;
+                    this->rotateLeft(sibling);
+                    sibling = left(up);
+                }
+                red(sibling) = red(up);
+                red(up) = false;
+                red(left(sibling)) = false;
+                this->rotateRight(up);
+                node = root;
+            }
+        }
+    }
+    if (node != nullptr) {
+        red(node) = false;
+    }
+}
+
+#endif /*!_ORDEREDINDEX_HPP_*/